@@ -0,0 +1,474 @@
+/*
+ * GStreamer - DTMF PIN Source Detection Plugin for the Repeater Project
+ *
+ * Copyright 2025 Robert Hensel VK3DG vk3dg@gmail.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Process-wide batch Goertzel engine.
+ *
+ * Registered streams are packed into groups of DTMF_BATCH_LANES, one stream
+ * per SIMD lane. Each stream stages its 8 kHz samples; once every active
+ * lane of a group holds a full block, one pass runs the 16-filter Goertzel
+ * recurrence for all lanes together and then applies the per-lane
+ * classification and debounce shared with the single-stream detector.
+ *
+ * A stream holding MAX_PENDING_BLOCKS forces a pass over whichever lanes
+ * are ready, so detection latency is bounded to two extra blocks (25.5ms)
+ * no matter how the other streams are paced. At the end of a stream,
+ * dtmf_batch_stream_flush() runs passes for the blocks it still has staged
+ * without waiting for the rest of the group.
+ * Digits found for a lane during a pass driven by another thread are
+ * returned on that lane's next process call.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "dtmfbatch.h"
+#include "dtmfgoertzel.h"
+
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+#define STAGING_BLOCKS 4
+#define MAX_PENDING_BLOCKS 3
+#define STAGING_SIZE (STAGING_BLOCKS * DTMF_GOERTZEL_BLOCK)
+#define LANE_DIGITS 32
+
+typedef struct _DtmfBatchGroup DtmfBatchGroup;
+
+typedef void (*BatchBlockFunc) (const gfloat * x, const gfloat * coeffs,
+    gfloat * power, gfloat * energy);
+
+struct _DtmfBatchStream
+{
+  DtmfBatchGroup *group;
+  gint lane;
+
+  gfloat staging[STAGING_SIZE];
+  gint staged;
+
+  DtmfGoertzelState state;
+  gfloat threshold;
+
+  /* Digits detected but not yet returned */
+  gchar out[LANE_DIGITS];
+  gint n_out;
+};
+
+struct _DtmfBatchGroup
+{
+  GMutex lock;
+  DtmfBatchStream *lanes[DTMF_BATCH_LANES];
+  gint n_active;
+
+  /* Sample-major block, x[n * DTMF_BATCH_LANES + lane] */
+  gfloat x[DTMF_GOERTZEL_BLOCK * DTMF_BATCH_LANES];
+  gfloat power[DTMF_GOERTZEL_FILTERS * DTMF_BATCH_LANES];
+  gfloat energy[DTMF_BATCH_LANES];
+};
+
+static GMutex engine_lock;
+static GList *groups = NULL;
+
+static BatchBlockFunc batch_block = NULL;
+static const gchar *batch_kernel = "scalar";
+
+static void
+batch_block_scalar (const gfloat * x, const gfloat * coeffs, gfloat * power,
+    gfloat * energy)
+{
+  gfloat s1[DTMF_GOERTZEL_FILTERS][DTMF_BATCH_LANES] = { {0} };
+  gfloat s2[DTMF_GOERTZEL_FILTERS][DTMF_BATCH_LANES] = { {0} };
+  gint n, k, l;
+
+  for (l = 0; l < DTMF_BATCH_LANES; l++)
+    energy[l] = 0.0f;
+
+  for (n = 0; n < DTMF_GOERTZEL_BLOCK; n++) {
+    const gfloat *xn = x + n * DTMF_BATCH_LANES;
+
+    for (l = 0; l < DTMF_BATCH_LANES; l++)
+      energy[l] += xn[l] * xn[l];
+
+    for (k = 0; k < DTMF_GOERTZEL_FILTERS; k++) {
+      for (l = 0; l < DTMF_BATCH_LANES; l++) {
+        gfloat s0 = (xn[l] - s2[k][l]) + coeffs[k] * s1[k][l];
+        s2[k][l] = s1[k][l];
+        s1[k][l] = s0;
+      }
+    }
+  }
+
+  for (k = 0; k < DTMF_GOERTZEL_FILTERS; k++) {
+    for (l = 0; l < DTMF_BATCH_LANES; l++) {
+      power[k * DTMF_BATCH_LANES + l] = s1[k][l] * s1[k][l]
+          + s2[k][l] * s2[k][l] - coeffs[k] * s1[k][l] * s2[k][l];
+    }
+  }
+}
+
+#ifdef HAVE_X86_DISPATCH
+__attribute__ ((target ("sse2")))
+static void
+batch_block_sse2 (const gfloat * x, const gfloat * coeffs, gfloat * power,
+    gfloat * energy)
+{
+  gint half, n, k;
+
+  /* Two passes of four lanes */
+  for (half = 0; half < DTMF_BATCH_LANES; half += 4) {
+    __m128 s1[DTMF_GOERTZEL_FILTERS], s2[DTMF_GOERTZEL_FILTERS];
+    __m128 e = _mm_setzero_ps ();
+
+    for (k = 0; k < DTMF_GOERTZEL_FILTERS; k++) {
+      s1[k] = _mm_setzero_ps ();
+      s2[k] = _mm_setzero_ps ();
+    }
+
+    for (n = 0; n < DTMF_GOERTZEL_BLOCK; n++) {
+      __m128 xv = _mm_loadu_ps (x + n * DTMF_BATCH_LANES + half);
+
+      e = _mm_add_ps (e, _mm_mul_ps (xv, xv));
+      for (k = 0; k < DTMF_GOERTZEL_FILTERS; k++) {
+        __m128 s0 = _mm_add_ps (_mm_sub_ps (xv, s2[k]),
+            _mm_mul_ps (_mm_set1_ps (coeffs[k]), s1[k]));
+        s2[k] = s1[k];
+        s1[k] = s0;
+      }
+    }
+
+    for (k = 0; k < DTMF_GOERTZEL_FILTERS; k++) {
+      __m128 c = _mm_set1_ps (coeffs[k]);
+      __m128 p = _mm_add_ps (_mm_mul_ps (s1[k], s1[k]),
+          _mm_mul_ps (s2[k], s2[k]));
+
+      p = _mm_sub_ps (p, _mm_mul_ps (c, _mm_mul_ps (s1[k], s2[k])));
+      _mm_storeu_ps (power + k * DTMF_BATCH_LANES + half, p);
+    }
+    _mm_storeu_ps (energy + half, e);
+  }
+}
+
+__attribute__ ((target ("avx2")))
+static void
+batch_block_avx2 (const gfloat * x, const gfloat * coeffs, gfloat * power,
+    gfloat * energy)
+{
+  __m256 s1[DTMF_GOERTZEL_FILTERS], s2[DTMF_GOERTZEL_FILTERS];
+  __m256 e = _mm256_setzero_ps ();
+  gint n, k;
+
+  for (k = 0; k < DTMF_GOERTZEL_FILTERS; k++) {
+    s1[k] = _mm256_setzero_ps ();
+    s2[k] = _mm256_setzero_ps ();
+  }
+
+  for (n = 0; n < DTMF_GOERTZEL_BLOCK; n++) {
+    __m256 xv = _mm256_loadu_ps (x + n * DTMF_BATCH_LANES);
+
+    e = _mm256_add_ps (e, _mm256_mul_ps (xv, xv));
+    for (k = 0; k < DTMF_GOERTZEL_FILTERS; k++) {
+      __m256 s0 = _mm256_add_ps (_mm256_sub_ps (xv, s2[k]),
+          _mm256_mul_ps (_mm256_set1_ps (coeffs[k]), s1[k]));
+      s2[k] = s1[k];
+      s1[k] = s0;
+    }
+  }
+
+  for (k = 0; k < DTMF_GOERTZEL_FILTERS; k++) {
+    __m256 c = _mm256_set1_ps (coeffs[k]);
+    __m256 p = _mm256_add_ps (_mm256_mul_ps (s1[k], s1[k]),
+        _mm256_mul_ps (s2[k], s2[k]));
+
+    p = _mm256_sub_ps (p, _mm256_mul_ps (c, _mm256_mul_ps (s1[k], s2[k])));
+    _mm256_storeu_ps (power + k * DTMF_BATCH_LANES, p);
+  }
+  _mm256_storeu_ps (energy, e);
+}
+#endif
+
+static void
+batch_init_once (void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized)) {
+    batch_block = batch_block_scalar;
+    batch_kernel = "scalar";
+#ifdef HAVE_X86_DISPATCH
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("avx2")) {
+      batch_block = batch_block_avx2;
+      batch_kernel = "avx2";
+    } else if (__builtin_cpu_supports ("sse2")) {
+      batch_block = batch_block_sse2;
+      batch_kernel = "sse2";
+    }
+#endif
+
+    g_once_init_leave (&initialized, 1);
+  }
+}
+
+const gchar *
+dtmf_batch_kernel_name (void)
+{
+  batch_init_once ();
+  return batch_kernel;
+}
+
+/* Called with the group lock held */
+static gboolean
+group_ready (DtmfBatchGroup * group)
+{
+  gint l;
+
+  for (l = 0; l < DTMF_BATCH_LANES; l++) {
+    if (group->lanes[l] && group->lanes[l]->staged < DTMF_GOERTZEL_BLOCK)
+      return FALSE;
+  }
+  return TRUE;
+}
+
+/* Run one block for every lane that has one staged. Called with the group
+ * lock held. */
+static void
+run_pass (DtmfBatchGroup * group)
+{
+  gboolean ready[DTMF_BATCH_LANES];
+  gint n, l;
+
+  for (l = 0; l < DTMF_BATCH_LANES; l++) {
+    DtmfBatchStream *s = group->lanes[l];
+
+    ready[l] = s && s->staged >= DTMF_GOERTZEL_BLOCK;
+
+    if (ready[l]) {
+      for (n = 0; n < DTMF_GOERTZEL_BLOCK; n++)
+        group->x[n * DTMF_BATCH_LANES + l] = s->staging[n];
+    } else {
+      for (n = 0; n < DTMF_GOERTZEL_BLOCK; n++)
+        group->x[n * DTMF_BATCH_LANES + l] = 0.0f;
+    }
+  }
+
+  batch_block (group->x, dtmf_goertzel_coeffs (), group->power,
+      group->energy);
+
+  for (l = 0; l < DTMF_BATCH_LANES; l++) {
+    DtmfBatchStream *s = group->lanes[l];
+    gchar hit;
+
+    if (!ready[l])
+      continue;
+
+    hit = dtmf_goertzel_classify (group->power + l, DTMF_BATCH_LANES,
+        group->energy[l], s->threshold);
+    hit = dtmf_goertzel_update (&s->state, hit);
+    if (hit && s->n_out < LANE_DIGITS)
+      s->out[s->n_out++] = hit;
+
+    s->staged -= DTMF_GOERTZEL_BLOCK;
+    memmove (s->staging, s->staging + DTMF_GOERTZEL_BLOCK,
+        sizeof (gfloat) * s->staged);
+  }
+}
+
+/* Register a new stream, packing it into the first group with a free lane */
+DtmfBatchStream *
+dtmf_batch_stream_register (void)
+{
+  DtmfBatchStream *stream;
+  DtmfBatchGroup *group = NULL;
+  GList *l;
+  gint lane;
+
+  batch_init_once ();
+
+  stream = g_new0 (DtmfBatchStream, 1);
+  stream->threshold = dtmf_goertzel_default_threshold ();
+
+  g_mutex_lock (&engine_lock);
+
+  for (l = groups; l; l = l->next) {
+    if (((DtmfBatchGroup *) l->data)->n_active < DTMF_BATCH_LANES) {
+      group = l->data;
+      break;
+    }
+  }
+
+  if (!group) {
+    group = g_new0 (DtmfBatchGroup, 1);
+    g_mutex_init (&group->lock);
+    groups = g_list_prepend (groups, group);
+  }
+
+  g_mutex_lock (&group->lock);
+  for (lane = 0; group->lanes[lane]; lane++);
+  group->lanes[lane] = stream;
+  group->n_active++;
+  stream->group = group;
+  stream->lane = lane;
+  g_mutex_unlock (&group->lock);
+
+  g_mutex_unlock (&engine_lock);
+
+  return stream;
+}
+
+void
+dtmf_batch_stream_unregister (DtmfBatchStream * stream)
+{
+  DtmfBatchGroup *group;
+  gboolean empty;
+
+  if (!stream)
+    return;
+
+  group = stream->group;
+
+  g_mutex_lock (&engine_lock);
+
+  g_mutex_lock (&group->lock);
+  group->lanes[stream->lane] = NULL;
+  empty = (--group->n_active == 0);
+  g_mutex_unlock (&group->lock);
+
+  if (empty) {
+    groups = g_list_remove (groups, group);
+    g_mutex_clear (&group->lock);
+    g_free (group);
+  }
+
+  g_mutex_unlock (&engine_lock);
+
+  g_free (stream);
+}
+
+void
+dtmf_batch_stream_reset (DtmfBatchStream * stream)
+{
+  g_mutex_lock (&stream->group->lock);
+  stream->staged = 0;
+  stream->state.last_hit = 0;
+  stream->state.in_digit = 0;
+  stream->n_out = 0;
+  g_mutex_unlock (&stream->group->lock);
+}
+
+/* Hand out the digits found for @stream. Called with the group lock
+ * held. */
+static gint
+take_digits (DtmfBatchStream * stream, gchar * digits, gint max_digits)
+{
+  gint count = MIN (stream->n_out, max_digits - 1);
+
+  memcpy (digits, stream->out, count);
+  if (max_digits > 0)
+    digits[count] = '\0';
+  stream->n_out = 0;
+
+  return count;
+}
+
+/* Stage 8 kHz samples for @stream, running group passes as blocks become
+ * available. Digits are written NUL terminated to @digits. Returns the
+ * number of digits. */
+gint
+dtmf_batch_stream_process (DtmfBatchStream * stream, const gint16 * samples,
+    gsize n_samples, gchar * digits, gint max_digits)
+{
+  DtmfBatchGroup *group = stream->group;
+  gint count;
+
+  g_mutex_lock (&group->lock);
+
+  for (;;) {
+    gsize chunk = MIN (n_samples, (gsize) (STAGING_SIZE - stream->staged));
+    gfloat *dst = stream->staging + stream->staged;
+    gsize i;
+
+    for (i = 0; i < chunk; i++)
+      dst[i] = samples[i];
+    stream->staged += chunk;
+    samples += chunk;
+    n_samples -= chunk;
+
+    if (stream->staged < DTMF_GOERTZEL_BLOCK)
+      break;
+
+    /* Wait for the rest of the group unless this lane is too far ahead */
+    if (n_samples == 0
+        && stream->staged < MAX_PENDING_BLOCKS * DTMF_GOERTZEL_BLOCK
+        && !group_ready (group))
+      break;
+
+    run_pass (group);
+  }
+
+  count = take_digits (stream, digits, max_digits);
+
+  g_mutex_unlock (&group->lock);
+
+  return count;
+}
+
+/* Analyse every whole block still staged for @stream, however far the
+ * rest of its group has got, for when no more samples will follow. Lanes
+ * without a block are left as they are. Digits are written NUL terminated
+ * to @digits. Returns the number of digits. */
+gint
+dtmf_batch_stream_flush (DtmfBatchStream * stream, gchar * digits,
+    gint max_digits)
+{
+  DtmfBatchGroup *group = stream->group;
+  gint count;
+
+  g_mutex_lock (&group->lock);
+
+  while (stream->staged >= DTMF_GOERTZEL_BLOCK)
+    run_pass (group);
+
+  count = take_digits (stream, digits, max_digits);
+
+  g_mutex_unlock (&group->lock);
+
+  return count;
+}
+
+/* Whether the last block analysed for @stream held a tone. The lane may be
+ * a few blocks behind the samples passed in while it waits for the rest
+ * of its group. */
+gboolean
+dtmf_batch_stream_in_tone (DtmfBatchStream * stream)
+{
+  gboolean in_tone;
+
+  g_mutex_lock (&stream->group->lock);
+  in_tone = stream->state.in_digit != 0 || stream->state.last_hit != 0;
+  g_mutex_unlock (&stream->group->lock);
+
+  return in_tone;
+}
@@ -0,0 +1,48 @@
+/*
+ * GStreamer - DTMF PIN Source Detection Plugin for the Repeater Project
+ *
+ * Copyright 2025 Robert Hensel VK3DG vk3dg@gmail.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __DTMF_BATCH_H__
+#define __DTMF_BATCH_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Streams packed into one SIMD pass, one stream per lane */
+#define DTMF_BATCH_LANES 8
+
+typedef struct _DtmfBatchStream DtmfBatchStream;
+
+DtmfBatchStream *dtmf_batch_stream_register (void);
+void dtmf_batch_stream_unregister (DtmfBatchStream * stream);
+void dtmf_batch_stream_reset (DtmfBatchStream * stream);
+
+gint dtmf_batch_stream_process (DtmfBatchStream * stream,
+    const gint16 * samples, gsize n_samples, gchar * digits, gint max_digits);
+gint dtmf_batch_stream_flush (DtmfBatchStream * stream, gchar * digits,
+    gint max_digits);
+gboolean dtmf_batch_stream_in_tone (DtmfBatchStream * stream);
+
+const gchar *dtmf_batch_kernel_name (void);
+
+G_END_DECLS
+
+#endif /* __DTMF_BATCH_H__ */
@@ -0,0 +1,282 @@
+/*
+ * GStreamer - DTMF PIN Source Detection Plugin for the Repeater Project
+ *
+ * Copyright 2025 Robert Hensel VK3DG vk3dg@gmail.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Polyphase rational decimator feeding the 8 kHz DTMF analysis path.
+ *
+ * The input rate is reduced to L/M = 8000/rate and a windowed-sinc lowpass
+ * prototype of L * taps coefficients is split into L phases. Each output
+ * sample is a single dot product of one phase against the most recent
+ * input history, so only the samples that are actually kept get computed.
+ * The full-rate buffer itself is never touched. S16, S32 and F32 input
+ * each have a loader of their own in front of the common filter.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "dtmfdecimator.h"
+
+#include <math.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* Lowpass cutoff in Hz. DTMF fundamentals stop at 1633 Hz, so anything
+ * folding back below ~2 kHz must come from above 6 kHz. */
+#define DECIMATOR_CUTOFF 3800.0
+
+struct _DtmfDecimator
+{
+  gint in_rate;
+  gint up;                      /* L */
+  gint down;                    /* M */
+  gint taps;                    /* taps per phase, multiple of 8 */
+
+  gfloat *coeffs;               /* up * taps, each phase stored reversed */
+
+  /* history (taps - 1 samples) followed by the current input */
+  gfloat *work;
+  gsize work_size;
+
+  /* position of the next output in the upsampled domain, relative to work[0] */
+  guint64 acc;
+};
+
+static gint
+gcd (gint a, gint b)
+{
+  while (b) {
+    gint t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+static void
+design_filter (DtmfDecimator * dec)
+{
+  gint n_total = dec->up * dec->taps;
+  gdouble fc = DECIMATOR_CUTOFF / ((gdouble) dec->in_rate * dec->up);
+  gdouble centre = (n_total - 1) / 2.0;
+  gdouble sum = 0.0;
+  gdouble *proto;
+  gint n, p, k;
+
+  proto = g_new (gdouble, n_total);
+
+  for (n = 0; n < n_total; n++) {
+    gdouble x = n - centre;
+    gdouble sinc = (x == 0.0) ? 2.0 * fc : sin (2.0 * G_PI * fc * x) / (G_PI * x);
+    gdouble w = 0.42 - 0.5 * cos (2.0 * G_PI * n / (n_total - 1))
+        + 0.08 * cos (4.0 * G_PI * n / (n_total - 1));
+
+    proto[n] = sinc * w;
+    sum += proto[n];
+  }
+
+  /* Unity DC gain per phase */
+  for (p = 0; p < dec->up; p++) {
+    for (k = 0; k < dec->taps; k++) {
+      dec->coeffs[p * dec->taps + (dec->taps - 1 - k)] =
+          (gfloat) (proto[p + k * dec->up] * dec->up / sum);
+    }
+  }
+
+  g_free (proto);
+}
+
+DtmfDecimator *
+dtmf_decimator_new (gint in_rate)
+{
+  DtmfDecimator *dec;
+  gint g;
+
+  g_return_val_if_fail (in_rate > DTMF_ANALYSIS_RATE, NULL);
+
+  dec = g_new0 (DtmfDecimator, 1);
+  g = gcd (DTMF_ANALYSIS_RATE, in_rate);
+  dec->in_rate = in_rate;
+  dec->up = DTMF_ANALYSIS_RATE / g;
+  dec->down = in_rate / g;
+
+  /* Keep the transition band roughly constant in Hz across input rates */
+  dec->taps = ((in_rate / 750) + 7) & ~7;
+  if (dec->taps < 16)
+    dec->taps = 16;
+
+  dec->coeffs = g_new0 (gfloat, dec->up * dec->taps);
+  design_filter (dec);
+
+  dtmf_decimator_reset (dec);
+
+  return dec;
+}
+
+void
+dtmf_decimator_free (DtmfDecimator * dec)
+{
+  if (!dec)
+    return;
+
+  g_free (dec->coeffs);
+  g_free (dec->work);
+  g_free (dec);
+}
+
+void
+dtmf_decimator_reset (DtmfDecimator * dec)
+{
+  if (dec->work)
+    memset (dec->work, 0, sizeof (gfloat) * (dec->taps - 1));
+  dec->acc = (guint64) (dec->taps - 1) * dec->up;
+}
+
+/* Upper bound on the number of samples one call can produce */
+gsize
+dtmf_decimator_max_output (DtmfDecimator * dec, gsize n_frames)
+{
+  return (n_frames * dec->up) / dec->down + 2;
+}
+
+static inline gfloat
+dot_product (const gfloat * x, const gfloat * h, gint taps)
+{
+#ifdef __SSE2__
+  __m128 s0 = _mm_setzero_ps ();
+  __m128 s1 = _mm_setzero_ps ();
+  gfloat r[4];
+  gint k;
+
+  for (k = 0; k < taps; k += 8) {
+    s0 = _mm_add_ps (s0, _mm_mul_ps (_mm_loadu_ps (x + k),
+            _mm_load_ps (h + k)));
+    s1 = _mm_add_ps (s1, _mm_mul_ps (_mm_loadu_ps (x + k + 4),
+            _mm_load_ps (h + k + 4)));
+  }
+  _mm_storeu_ps (r, _mm_add_ps (s0, s1));
+  return (r[0] + r[1]) + (r[2] + r[3]);
+#else
+  gfloat s = 0.0f;
+  gint k;
+
+  for (k = 0; k < taps; k++)
+    s += x[k] * h[k];
+  return s;
+#endif
+}
+
+/* Make room for @n_frames input samples after the history and return
+ * where they go */
+static gfloat *
+input_space (DtmfDecimator * dec, gsize n_frames)
+{
+  gsize hist = dec->taps - 1;
+  gsize n_work = hist + n_frames;
+
+  if (n_work > dec->work_size) {
+    gfloat *work = g_new0 (gfloat, n_work);
+
+    if (dec->work)
+      memcpy (work, dec->work, sizeof (gfloat) * hist);
+    g_free (dec->work);
+    dec->work = work;
+    dec->work_size = n_work;
+  }
+
+  return dec->work + hist;
+}
+
+/* Input loaders, one per sample format, scaling to the S16 range */
+#define DEFINE_LOAD(name, type, scale) \
+static void \
+name (gfloat * dst, const type * in, gsize n_frames, gint stride) \
+{ \
+  gsize i; \
+\
+  for (i = 0; i < n_frames; i++) \
+    dst[i] = in[i * stride] * (scale); \
+}
+
+DEFINE_LOAD (load_s16, gint16, 1.0f)
+DEFINE_LOAD (load_s32, gint32, 1.0f / 65536.0f)
+DEFINE_LOAD (load_f32, gfloat, 32768.0f)
+
+/* Run the filter over the @n_frames samples loaded after the history */
+static gsize
+filter_input (DtmfDecimator * dec, gsize n_frames, gint16 * out)
+{
+  gsize hist = dec->taps - 1;
+  gsize n_work = hist + n_frames;
+  gsize n_out = 0;
+
+  for (;;) {
+    guint64 base = dec->acc / dec->up;
+    gint phase = dec->acc % dec->up;
+    gfloat y;
+
+    if (base >= n_work)
+      break;
+
+    y = dot_product (dec->work + base - hist,
+        dec->coeffs + (gsize) phase * dec->taps, dec->taps);
+    out[n_out++] = (gint16) CLAMP (lrintf (y), G_MININT16, G_MAXINT16);
+    dec->acc += dec->down;
+  }
+
+  /* Keep the last taps - 1 samples as history for the next call */
+  memmove (dec->work, dec->work + n_frames, sizeof (gfloat) * hist);
+  dec->acc -= (guint64) n_frames * dec->up;
+
+  return n_out;
+}
+
+/* Decimate @n_frames samples read from @in every @stride samples into @out.
+ * Returns the number of 8 kHz samples written. */
+gsize
+dtmf_decimator_process (DtmfDecimator * dec, const gint16 * in,
+    gsize n_frames, gint stride, gint16 * out)
+{
+  load_s16 (input_space (dec, n_frames), in, n_frames, stride);
+  return filter_input (dec, n_frames, out);
+}
+
+/* As dtmf_decimator_process(), for S32 input */
+gsize
+dtmf_decimator_process_s32 (DtmfDecimator * dec, const gint32 * in,
+    gsize n_frames, gint stride, gint16 * out)
+{
+  load_s32 (input_space (dec, n_frames), in, n_frames, stride);
+  return filter_input (dec, n_frames, out);
+}
+
+/* As dtmf_decimator_process(), for F32 input in [-1.0, 1.0] */
+gsize
+dtmf_decimator_process_f32 (DtmfDecimator * dec, const gfloat * in,
+    gsize n_frames, gint stride, gint16 * out)
+{
+  load_f32 (input_space (dec, n_frames), in, n_frames, stride);
+  return filter_input (dec, n_frames, out);
+}
@@ -0,0 +1,48 @@
+/*
+ * GStreamer - DTMF PIN Source Detection Plugin for the Repeater Project
+ *
+ * Copyright 2025 Robert Hensel VK3DG vk3dg@gmail.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __DTMF_DECIMATOR_H__
+#define __DTMF_DECIMATOR_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Sample rate of the DTMF analysis path */
+#define DTMF_ANALYSIS_RATE 8000
+
+typedef struct _DtmfDecimator DtmfDecimator;
+
+DtmfDecimator *dtmf_decimator_new (gint in_rate);
+void dtmf_decimator_free (DtmfDecimator * dec);
+void dtmf_decimator_reset (DtmfDecimator * dec);
+
+gsize dtmf_decimator_max_output (DtmfDecimator * dec, gsize n_frames);
+gsize dtmf_decimator_process (DtmfDecimator * dec, const gint16 * in,
+    gsize n_frames, gint stride, gint16 * out);
+gsize dtmf_decimator_process_s32 (DtmfDecimator * dec, const gint32 * in,
+    gsize n_frames, gint stride, gint16 * out);
+gsize dtmf_decimator_process_f32 (DtmfDecimator * dec, const gfloat * in,
+    gsize n_frames, gint stride, gint16 * out);
+
+G_END_DECLS
+
+#endif /* __DTMF_DECIMATOR_H__ */
@@ -0,0 +1,174 @@
+/*
+ * GStreamer - DTMF PIN Source Detection Plugin for the Repeater Project
+ *
+ * Copyright 2025 Robert Hensel VK3DG vk3dg@gmail.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Splits interleaved S16 audio into one plane per channel for the
+ * per-channel detectors.
+ *
+ * With SSE2, power-of-two channel counts are split in registers: each pass
+ * separates even and odd samples of a vector pair, so log2(channels) passes
+ * over 8 frames leave one channel per vector. Other layouts take the
+ * scalar path.
+ *
+ * S32 and F32 input is converted to S16 one channel at a time, with a
+ * function per format so the loops carry no format test. Mono input is
+ * converted eight samples at a time with SSE2.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "dtmfdeinterleave.h"
+
+#include <math.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+static void
+deinterleave_scalar (const gint16 * in, gsize start, gsize n_frames,
+    gint channels, gint16 * out)
+{
+  gsize i;
+  gint c;
+
+  for (c = 0; c < channels; c++) {
+    gint16 *plane = out + c * n_frames;
+
+    for (i = start; i < n_frames; i++)
+      plane[i] = in[i * channels + c];
+  }
+}
+
+#ifdef __SSE2__
+/* Even samples of a:b into even, odd samples into odd */
+static inline void
+split_even_odd (__m128i a, __m128i b, __m128i * even, __m128i * odd)
+{
+  *even = _mm_packs_epi32 (_mm_srai_epi32 (_mm_slli_epi32 (a, 16), 16),
+      _mm_srai_epi32 (_mm_slli_epi32 (b, 16), 16));
+  *odd = _mm_packs_epi32 (_mm_srai_epi32 (a, 16), _mm_srai_epi32 (b, 16));
+}
+
+/* 8 frames per iteration, @channels is 2, 4 or 8 */
+static gsize
+deinterleave_sse2 (const gint16 * in, gsize n_frames, gint channels,
+    gint16 * out)
+{
+  gint half = channels / 2;
+  gsize i;
+  gint k, w;
+
+  for (i = 0; i + 8 <= n_frames; i += 8) {
+    const __m128i *src = (const __m128i *) (in + i * channels);
+    __m128i v[8], t[8];
+
+    for (k = 0; k < channels; k++)
+      v[k] = _mm_loadu_si128 (src + k);
+
+    /* After the last pass v[k] holds 8 samples of channel k */
+    for (w = channels; w > 1; w /= 2) {
+      for (k = 0; k < half; k++)
+        split_even_odd (v[2 * k], v[2 * k + 1], &t[k], &t[k + half]);
+      for (k = 0; k < channels; k++)
+        v[k] = t[k];
+    }
+
+    for (k = 0; k < channels; k++)
+      _mm_storeu_si128 ((__m128i *) (out + k * n_frames + i), v[k]);
+  }
+
+  return i;
+}
+#endif
+
+/* Write @n_frames samples of each channel to @out, channel c starting at
+ * out + c * n_frames */
+void
+dtmf_deinterleave_s16 (const gint16 * in, gsize n_frames, gint channels,
+    gint16 * out)
+{
+  gsize done = 0;
+
+#ifdef __SSE2__
+  if (channels == 2 || channels == 4 || channels == 8)
+    done = deinterleave_sse2 (in, n_frames, channels, out);
+#endif
+
+  deinterleave_scalar (in, done, n_frames, channels, out);
+}
+
+/* Convert @n_frames samples of one channel of interleaved S32 input, @in
+ * pointing at the channel's first sample, to S16 at @out */
+void
+dtmf_deinterleave_channel_s32 (const gint32 * in, gsize n_frames,
+    gint channels, gint16 * out)
+{
+  gsize i = 0;
+
+#ifdef __SSE2__
+  if (channels == 1) {
+    for (; i + 8 <= n_frames; i += 8) {
+      __m128i a = _mm_loadu_si128 ((const __m128i *) (in + i));
+      __m128i b = _mm_loadu_si128 ((const __m128i *) (in + i + 4));
+
+      _mm_storeu_si128 ((__m128i *) (out + i),
+          _mm_packs_epi32 (_mm_srai_epi32 (a, 16), _mm_srai_epi32 (b, 16)));
+    }
+  }
+#endif
+
+  for (; i < n_frames; i++)
+    out[i] = in[i * channels] >> 16;
+}
+
+/* As dtmf_deinterleave_channel_s32(), for F32 input in [-1.0, 1.0].
+ * Samples beyond full scale are clipped. */
+void
+dtmf_deinterleave_channel_f32 (const gfloat * in, gsize n_frames,
+    gint channels, gint16 * out)
+{
+  gsize i = 0;
+
+#ifdef __SSE2__
+  if (channels == 1) {
+    const __m128 scale = _mm_set1_ps (32768.0f);
+    const __m128 lo = _mm_set1_ps (-32768.0f);
+    const __m128 hi = _mm_set1_ps (32767.0f);
+
+    for (; i + 8 <= n_frames; i += 8) {
+      __m128 a = _mm_mul_ps (_mm_loadu_ps (in + i), scale);
+      __m128 b = _mm_mul_ps (_mm_loadu_ps (in + i + 4), scale);
+
+      a = _mm_min_ps (_mm_max_ps (a, lo), hi);
+      b = _mm_min_ps (_mm_max_ps (b, lo), hi);
+      _mm_storeu_si128 ((__m128i *) (out + i),
+          _mm_packs_epi32 (_mm_cvtps_epi32 (a), _mm_cvtps_epi32 (b)));
+    }
+  }
+#endif
+
+  for (; i < n_frames; i++)
+    out[i] = lrintf (CLAMP (in[i * channels] * 32768.0f, -32768.0f,
+            32767.0f));
+}
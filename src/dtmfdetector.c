@@ -0,0 +1,590 @@
+/*
+ * GStreamer - DTMF PIN Source Detection Plugin for the Repeater Project
+ *
+ * Copyright 2025 Robert Hensel VK3DG vk3dg@gmail.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Common front for the DTMF detection engines. Every engine takes 8 kHz
+ * mono S16 samples and returns the digits that started in them, and tells
+ * whether a tone is sounding at the end of them.
+ *
+ * An optional energy gate in front of the engine skips blocks that cannot
+ * hold a tone pair. The gate works in blocks of DTMF_GOERTZEL_BLOCK
+ * samples aligned with those of the engines, and measures each block's
+ * energy and mean squared slope. A pair at the engine's detection
+ * threshold has GATE_MARGIN_DB more energy than the gate level, and since
+ * it carries most of the block energy between 697 and 1633 Hz, the ratio
+ * of slope to energy lies between GATE_MIN_SLOPE and GATE_MAX_SLOPE.
+ * Blocks outside either limit are quiet: the engine would not have found
+ * a tone in them.
+ *
+ * The engine only stops after GATE_HANGOVER_BLOCKS quiet blocks with no
+ * tone sounding, so it has seen the end of any tone and its debounce
+ * history holds no hits. Skipped samples are kept until their block is
+ * complete. When a block turns out loud, the engine is told about the gap
+ * and fed the whole block, so it resumes in the state it would have been
+ * in had it seen the silence.
+ *
+ * Level and twist limits that were set go to spandsp through
+ * dtmf_rx_parms() and are put back after every reset, as dtmf_rx_init()
+ * restores its defaults; the others stay at spandsp's own. The gate level
+ * follows the threshold the engine detects at. A minimum duration is
+ * enforced here for every engine: a digit is held back, block by block,
+ * until its tone has lasted that long, and dropped if the tone ends first.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "dtmfdetector.h"
+#include "dtmfgoertzel.h"
+#include "dtmfbatch.h"
+
+#include <math.h>
+#include <spandsp.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* Energy gate limits, see above. The level is 6 dB under a pair at the
+ * detection threshold of the engine, see engine_threshold(). */
+#define GATE_MARGIN_DB          6.0
+#define GATE_MIN_SLOPE          0.2     /* 0.82 of a 697 Hz tone's 0.29 */
+#define GATE_MAX_SLOPE          2.0     /* 0.82 of 1633 Hz's 1.43, rest at 4 */
+
+/* Quiet blocks before the engine stops, more than the batch engine keeps
+ * staged */
+#define GATE_HANGOVER_BLOCKS    4
+
+/* Tone heard by the time an engine reports it, two blocks of hits */
+#define REPORT_SAMPLES          (2 * DTMF_GOERTZEL_BLOCK)
+
+struct _DtmfDetector
+{
+  DtmfDetectorEngine engine;
+
+  dtmf_rx_state_t *dtmf_state;
+  gboolean tone;                /* set by the spandsp realtime callback */
+  DtmfGoertzel *goertzel;
+  DtmfBatchStream *batch;
+
+  DtmfDetectorParams params;
+  gboolean tuned;               /* a level, twist or filter is set */
+
+  /* Digit waiting for its tone to last min_samples */
+  guint64 min_samples;
+  gchar pending;
+  guint64 pending_samples;
+
+  /* Energy gate. fill follows the block position of the engine even while
+   * the gate is off. */
+  gboolean gate;
+  gboolean skipping;            /* engine stopped, samples go to held */
+  gboolean loud;                /* current block counts as loud */
+  gint fill;
+  gint quiet_blocks;
+  gint16 prev;                  /* last sample, for the slope */
+  guint64 energy;
+  guint64 slope;
+  guint64 min_energy;
+  gint16 held[DTMF_GOERTZEL_BLOCK];
+  guint64 gap;                  /* samples skipped since the engine stopped */
+  guint64 skipped;
+};
+
+/* spandsp reports tones as they start and end, code 0 being the end */
+static void
+spandsp_tone_report (void *user_data, int code, int level, int delay)
+{
+  DtmfDetector *det = user_data;
+
+  det->tone = code != 0;
+}
+
+/* Level in dBm0 each tone of a pair must reach for the engine to report
+ * it. spandsp takes the threshold that was set, or keeps its own default;
+ * the goertzel engines have a fixed one. */
+static gdouble
+engine_threshold (DtmfDetector * det)
+{
+  if (!det->dtmf_state)
+    return DTMF_GOERTZEL_THRESHOLD_DBM0;
+  if (det->params.threshold == DTMF_DETECTOR_PARAM_UNSET)
+    return DTMF_DETECTOR_DEFAULT_THRESHOLD;
+
+  return det->params.threshold;
+}
+
+/* Block energy of a tone pair at the gate level, GATE_MARGIN_DB under a
+ * pair at the engine's threshold. A full scale sine is +3.14dBm0 and each
+ * tone of the pair adds half its squared amplitude. */
+static guint64
+gate_min_energy (DtmfDetector * det)
+{
+  gdouble amplitude;
+
+  amplitude = 32767.0 * pow (10.0, (engine_threshold (det) - GATE_MARGIN_DB
+          - 3.14) / 20.0);
+
+  return (guint64) (amplitude * amplitude * DTMF_GOERTZEL_BLOCK);
+}
+
+/* Hand level and twist limits to spandsp. The unset values are those
+ * dtmf_rx_parms() takes for leaving a limit alone. */
+static void
+engine_apply_params (DtmfDetector * det)
+{
+  if (!det->dtmf_state)
+    return;
+
+  dtmf_rx_parms (det->dtmf_state, det->params.filter_dialtone,
+      det->params.twist, det->params.reverse_twist, det->params.threshold);
+}
+
+DtmfDetector *
+dtmf_detector_new (DtmfDetectorEngine engine)
+{
+  DtmfDetector *det = g_new0 (DtmfDetector, 1);
+
+  det->engine = engine;
+  dtmf_detector_params_init (&det->params);
+
+  switch (engine) {
+    case DTMF_DETECTOR_ENGINE_GOERTZEL:
+      det->goertzel = dtmf_goertzel_new ();
+      break;
+    case DTMF_DETECTOR_ENGINE_BATCH:
+      det->batch = dtmf_batch_stream_register ();
+      break;
+    case DTMF_DETECTOR_ENGINE_SPANDSP:
+    default:
+      det->dtmf_state = dtmf_rx_init (NULL, NULL, NULL);
+      if (!det->dtmf_state) {
+        g_free (det);
+        return NULL;
+      }
+      dtmf_rx_set_realtime_callback (det->dtmf_state, spandsp_tone_report,
+          det);
+      break;
+  }
+  det->min_energy = gate_min_energy (det);
+
+  return det;
+}
+
+void
+dtmf_detector_free (DtmfDetector * det)
+{
+  if (!det)
+    return;
+
+  if (det->dtmf_state)
+    dtmf_rx_free (det->dtmf_state);
+  dtmf_goertzel_free (det->goertzel);
+  dtmf_batch_stream_unregister (det->batch);
+  g_free (det);
+}
+
+static void
+gate_reset (DtmfDetector * det)
+{
+  det->skipping = FALSE;
+  det->loud = FALSE;
+  det->fill = 0;
+  det->quiet_blocks = 0;
+  det->prev = 0;
+  det->energy = 0;
+  det->slope = 0;
+  det->gap = 0;
+}
+
+void
+dtmf_detector_reset (DtmfDetector * det)
+{
+  gate_reset (det);
+  det->pending = 0;
+
+  if (det->dtmf_state) {
+    dtmf_rx_init (det->dtmf_state, NULL, NULL);
+    dtmf_rx_set_realtime_callback (det->dtmf_state, spandsp_tone_report,
+        det);
+    if (det->tuned)
+      engine_apply_params (det);
+    det->tone = FALSE;
+  }
+  if (det->goertzel)
+    dtmf_goertzel_reset (det->goertzel);
+  if (det->batch)
+    dtmf_batch_stream_reset (det->batch);
+}
+
+DtmfDetectorEngine
+dtmf_detector_get_engine (DtmfDetector * det)
+{
+  return det->engine;
+}
+
+static gint
+engine_process (DtmfDetector * det, const gint16 * samples, gsize n_samples,
+    gchar * digits, gint max_digits)
+{
+  if (det->goertzel)
+    return dtmf_goertzel_process (det->goertzel, samples, n_samples, digits,
+        max_digits);
+  if (det->batch)
+    return dtmf_batch_stream_process (det->batch, samples, n_samples, digits,
+        max_digits);
+
+  dtmf_rx (det->dtmf_state, (const int16_t *) samples, n_samples);
+  return dtmf_rx_get (det->dtmf_state, digits, max_digits);
+}
+
+static gboolean
+engine_in_tone (DtmfDetector * det)
+{
+  if (det->goertzel)
+    return dtmf_goertzel_in_tone (det->goertzel);
+  if (det->batch)
+    return dtmf_batch_stream_in_tone (det->batch);
+
+  return det->tone;
+}
+
+/* Restart the engine after @n_samples it did not see. Its debounce
+ * history holds no hits at this point, so only the partial block is
+ * dropped. */
+static void
+engine_fillin (DtmfDetector * det, guint64 n_samples)
+{
+  if (det->goertzel)
+    dtmf_goertzel_reset (det->goertzel);
+  else if (det->batch)
+    dtmf_batch_stream_reset (det->batch);
+  else
+    dtmf_rx_fillin (det->dtmf_state, MIN (n_samples, G_MAXINT));
+}
+
+/* Add the energy and squared slope of @n samples to the current block */
+static void
+gate_measure (DtmfDetector * det, const gint16 * x, gsize n)
+{
+  guint64 energy = 0, slope = 0;
+  gint64 d;
+  gsize i = 1;
+
+  if (n == 0)
+    return;
+
+  d = x[0] - det->prev;
+  energy += (gint32) x[0] * x[0];
+  slope += d * d;
+
+#ifdef __SSE2__
+  {
+    /* Halved samples keep two squared differences in 31 bits */
+    const __m128i zero = _mm_setzero_si128 ();
+    __m128i e64 = zero, s64 = zero;
+    guint64 sum[2];
+
+    for (; i + 8 <= n; i += 8) {
+      __m128i a = _mm_srai_epi16 (_mm_loadu_si128 ((const __m128i *) (x + i)),
+          1);
+      __m128i b = _mm_srai_epi16 (_mm_loadu_si128 ((const __m128i *) (x + i -
+                  1)), 1);
+      __m128i e = _mm_madd_epi16 (a, a);
+      __m128i s;
+
+      b = _mm_sub_epi16 (a, b);
+      s = _mm_madd_epi16 (b, b);
+      e64 = _mm_add_epi64 (e64, _mm_unpacklo_epi32 (e, zero));
+      e64 = _mm_add_epi64 (e64, _mm_unpackhi_epi32 (e, zero));
+      s64 = _mm_add_epi64 (s64, _mm_unpacklo_epi32 (s, zero));
+      s64 = _mm_add_epi64 (s64, _mm_unpackhi_epi32 (s, zero));
+    }
+
+    _mm_storeu_si128 ((__m128i *) sum, e64);
+    energy += (sum[0] + sum[1]) * 4;
+    _mm_storeu_si128 ((__m128i *) sum, s64);
+    slope += (sum[0] + sum[1]) * 4;
+  }
+#endif
+
+  for (; i < n; i++) {
+    d = x[i] - x[i - 1];
+    energy += (gint32) x[i] * x[i];
+    slope += d * d;
+  }
+
+  det->prev = x[n - 1];
+  det->energy += energy;
+  det->slope += slope;
+}
+
+/* Whether the finished block could hold a tone pair */
+static gboolean
+gate_block_loud (DtmfDetector * det)
+{
+  if (det->loud)
+    return TRUE;
+  if (det->energy < det->min_energy)
+    return FALSE;
+
+  return det->slope >= GATE_MIN_SLOPE * det->energy &&
+      det->slope <= GATE_MAX_SLOPE * det->energy;
+}
+
+/* Decide on the block just finished. Returns the digits found when the
+ * engine resumes on it. */
+static gint
+gate_end_block (DtmfDetector * det, gchar * digits, gint max_digits)
+{
+  gboolean loud = gate_block_loud (det);
+
+  det->fill = 0;
+  det->loud = FALSE;
+  det->energy = 0;
+  det->slope = 0;
+
+  if (det->skipping) {
+    if (!loud) {
+      det->gap += DTMF_GOERTZEL_BLOCK;
+      det->skipped += DTMF_GOERTZEL_BLOCK;
+      return 0;
+    }
+
+    engine_fillin (det, det->gap);
+    det->skipping = FALSE;
+    det->quiet_blocks = 0;
+    det->gap = 0;
+    return engine_process (det, det->held, DTMF_GOERTZEL_BLOCK, digits,
+        max_digits);
+  }
+
+  det->quiet_blocks = loud ? 0 : det->quiet_blocks + 1;
+  if (det->quiet_blocks >= GATE_HANGOVER_BLOCKS && !engine_in_tone (det))
+    det->skipping = TRUE;
+
+  return 0;
+}
+
+/* Run the engine behind the energy gate over @n_samples samples */
+static gint
+gated_process (DtmfDetector * det, const gint16 * samples,
+    gsize n_samples, gchar * digits, gint max_digits)
+{
+  gint count = 0;
+
+  if (!det->gate) {
+    det->fill = (det->fill + n_samples) % DTMF_GOERTZEL_BLOCK;
+    return engine_process (det, samples, n_samples, digits, max_digits);
+  }
+
+  while (n_samples > 0) {
+    gsize len = MIN (n_samples, (gsize) (DTMF_GOERTZEL_BLOCK - det->fill));
+
+    gate_measure (det, samples, len);
+    if (det->skipping)
+      memcpy (det->held + det->fill, samples, len * sizeof (gint16));
+    else
+      count += engine_process (det, samples, len, digits + count,
+          max_digits - count - 1);
+
+    det->fill += len;
+    samples += len;
+    n_samples -= len;
+
+    if (det->fill == DTMF_GOERTZEL_BLOCK)
+      count += gate_end_block (det, digits + count, max_digits - count - 1);
+  }
+
+  if (max_digits > 0)
+    digits[count] = '\0';
+
+  return count;
+}
+
+/* Whether a tone was sounding at the end of the samples processed last */
+gboolean
+dtmf_detector_in_tone (DtmfDetector * det)
+{
+  return !det->skipping && engine_in_tone (det);
+}
+
+/* Run the detector over @n_samples 8 kHz samples. Detected digits are
+ * written NUL terminated to @digits. Returns the number of digits. */
+gint
+dtmf_detector_process (DtmfDetector * det, const gint16 * samples,
+    gsize n_samples, gchar * digits, gint max_digits)
+{
+  gchar found[DTMF_DETECTOR_MAX_DIGITS];
+  gint count = 0;
+  gint i, n;
+
+  if (det->min_samples <= REPORT_SAMPLES)
+    return gated_process (det, samples, n_samples, digits, max_digits);
+
+  /* Follow the tone of a reported digit one block at a time */
+  while (n_samples > 0) {
+    gsize len = MIN (n_samples, (gsize) (DTMF_GOERTZEL_BLOCK - det->fill));
+
+    n = gated_process (det, samples, len, found, sizeof (found));
+    for (i = 0; i < n; i++) {
+      det->pending = found[i];
+      det->pending_samples = REPORT_SAMPLES;
+    }
+
+    if (det->pending && !dtmf_detector_in_tone (det)) {
+      det->pending = 0;
+    } else if (det->pending) {
+      if (n == 0)
+        det->pending_samples += len;
+      if (det->pending_samples >= det->min_samples && count < max_digits - 1) {
+        digits[count++] = det->pending;
+        det->pending = 0;
+      }
+    }
+
+    samples += len;
+    n_samples -= len;
+  }
+
+  if (max_digits > 0)
+    digits[count] = '\0';
+
+  return count;
+}
+
+/* Finish detection at the end of the stream. The batch engine may still
+ * hold whole blocks waiting for the rest of its group; they are analysed
+ * now. A digit whose tone has not yet lasted the minimum duration is
+ * dropped, as no more of it will come. Returns the number of digits
+ * written NUL terminated to @digits. */
+gint
+dtmf_detector_flush (DtmfDetector * det, gchar * digits, gint max_digits)
+{
+  gint count = 0;
+
+  if (det->batch && !det->skipping)
+    count = dtmf_batch_stream_flush (det->batch, digits, max_digits);
+
+  det->pending = 0;
+  if (det->min_samples > REPORT_SAMPLES)
+    count = 0;
+
+  if (max_digits > 0)
+    digits[count] = '\0';
+
+  return count;
+}
+
+void
+dtmf_detector_params_init (DtmfDetectorParams * params)
+{
+  params->threshold = DTMF_DETECTOR_PARAM_UNSET;
+  params->twist = DTMF_DETECTOR_PARAM_UNSET;
+  params->reverse_twist = DTMF_DETECTOR_PARAM_UNSET;
+  params->filter_dialtone = DTMF_DETECTOR_FILTER_UNSET;
+  params->min_duration = 0;
+}
+
+static gboolean
+params_equal (const DtmfDetectorParams * a, const DtmfDetectorParams * b)
+{
+  return a->threshold == b->threshold && a->twist == b->twist
+      && a->reverse_twist == b->reverse_twist
+      && a->filter_dialtone == b->filter_dialtone
+      && a->min_duration == b->min_duration;
+}
+
+/* Change the detection parameters. Takes effect with the next samples,
+ * without a reset, so a tone under way is not lost. A limit that is unset
+ * keeps spandsp's current setting, and a detector with none set never
+ * calls dtmf_rx_parms(). */
+void
+dtmf_detector_set_params (DtmfDetector * det,
+    const DtmfDetectorParams * params)
+{
+  if (params_equal (params, &det->params))
+    return;
+
+  det->params = *params;
+  if (params->filter_dialtone != DTMF_DETECTOR_FILTER_UNSET)
+    det->params.filter_dialtone = ! !params->filter_dialtone;
+  det->tuned = params->threshold != DTMF_DETECTOR_PARAM_UNSET
+      || params->twist != DTMF_DETECTOR_PARAM_UNSET
+      || params->reverse_twist != DTMF_DETECTOR_PARAM_UNSET
+      || params->filter_dialtone != DTMF_DETECTOR_FILTER_UNSET;
+  if (det->tuned)
+    engine_apply_params (det);
+
+  det->min_samples = (guint64) params->min_duration * 8;     /* 8 kHz */
+  if (det->min_samples <= REPORT_SAMPLES)
+    det->pending = 0;
+
+  det->min_energy = gate_min_energy (det);
+}
+
+/* Enable or disable the energy gate. Takes effect at once; a block that
+ * is already under way when the gate comes on counts as loud. */
+void
+dtmf_detector_set_gate (DtmfDetector * det, gboolean gate)
+{
+  gchar digits[DTMF_DETECTOR_MAX_DIGITS];
+
+  gate = ! !gate;
+  if (gate == det->gate)
+    return;
+
+  det->gate = gate;
+  if (gate) {
+    det->loud = det->fill > 0;
+    det->quiet_blocks = 0;
+    det->energy = 0;
+    det->slope = 0;
+    return;
+  }
+
+  if (!det->skipping)
+    return;
+
+  /* Give the engine the samples of the block under way, which are too
+   * few to finish a digit */
+  engine_fillin (det, det->gap);
+  engine_process (det, det->held, det->fill, digits,
+      DTMF_DETECTOR_MAX_DIGITS);
+  det->skipping = FALSE;
+  det->gap = 0;
+}
+
+gboolean
+dtmf_detector_get_gate (DtmfDetector * det)
+{
+  return det->gate;
+}
+
+/* Samples the energy gate kept from the engine since the detector was
+ * created */
+guint64
+dtmf_detector_get_skipped (DtmfDetector * det)
+{
+  return det->skipped;
+}
@@ -0,0 +1,82 @@
+/*
+ * GStreamer - DTMF PIN Source Detection Plugin for the Repeater Project
+ *
+ * Copyright 2025 Robert Hensel VK3DG vk3dg@gmail.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __DTMF_DETECTOR_H__
+#define __DTMF_DETECTOR_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Maximum number of digits returned by a single process call */
+#define DTMF_DETECTOR_MAX_DIGITS 128
+
+typedef enum {
+  DTMF_DETECTOR_ENGINE_SPANDSP,
+  DTMF_DETECTOR_ENGINE_GOERTZEL,
+  DTMF_DETECTOR_ENGINE_BATCH
+} DtmfDetectorEngine;
+
+typedef struct _DtmfDetector DtmfDetector;
+
+/* Defaults of spandsp's dtmf_rx, in effect while a parameter is unset */
+#define DTMF_DETECTOR_DEFAULT_THRESHOLD     (-42.0)
+#define DTMF_DETECTOR_DEFAULT_TWIST         8.0
+#define DTMF_DETECTOR_DEFAULT_REVERSE_TWIST 4.0
+
+/* Unset level, twist and dial tone filter, the values that make
+ * dtmf_rx_parms() leave a setting alone */
+#define DTMF_DETECTOR_PARAM_UNSET           (-99.0)
+#define DTMF_DETECTOR_FILTER_UNSET          (-1)
+
+/* Detection parameters. Level and twist only tune the spandsp engine,
+ * the minimum duration applies to all of them. */
+typedef struct {
+  gdouble threshold;            /* dBm0 each tone of a pair must reach */
+  gdouble twist;                /* dB the high tone may be below the low */
+  gdouble reverse_twist;        /* dB the low tone may be below the high */
+  gint filter_dialtone;         /* TRUE, FALSE or DTMF_DETECTOR_FILTER_UNSET */
+  guint min_duration;           /* ms a tone must last, 0 for no limit */
+} DtmfDetectorParams;
+
+DtmfDetector *dtmf_detector_new (DtmfDetectorEngine engine);
+void dtmf_detector_free (DtmfDetector * det);
+void dtmf_detector_reset (DtmfDetector * det);
+
+DtmfDetectorEngine dtmf_detector_get_engine (DtmfDetector * det);
+
+gint dtmf_detector_process (DtmfDetector * det, const gint16 * samples,
+    gsize n_samples, gchar * digits, gint max_digits);
+gint dtmf_detector_flush (DtmfDetector * det, gchar * digits,
+    gint max_digits);
+gboolean dtmf_detector_in_tone (DtmfDetector * det);
+
+void dtmf_detector_params_init (DtmfDetectorParams * params);
+void dtmf_detector_set_params (DtmfDetector * det,
+    const DtmfDetectorParams * params);
+
+void dtmf_detector_set_gate (DtmfDetector * det, gboolean gate);
+gboolean dtmf_detector_get_gate (DtmfDetector * det);
+guint64 dtmf_detector_get_skipped (DtmfDetector * det);
+
+G_END_DECLS
+
+#endif /* __DTMF_DETECTOR_H__ */
@@ -0,0 +1,164 @@
+/*
+ * GStreamer - DTMF PIN Source Detection Plugin for the Repeater Project
+ *
+ * Copyright 2025 Robert Hensel VK3DG vk3dg@gmail.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Lock-free single-producer single-consumer ring of fixed-size records.
+ *
+ * The producer and the consumer each own one index and only read the
+ * other's, so neither ever waits. A full ring drops the new record and
+ * counts it rather than blocking the producer. The indices run freely and
+ * wrap at 2^32, the ring size is a power of two so the slot is the index
+ * masked.
+ *
+ * On Linux the consumer can ask for an eventfd that the producer signals
+ * after every record, to sleep in poll() rather than spin.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "dtmfeventring.h"
+
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+/* Keep the two indices on separate cache lines */
+#define CACHE_LINE 64
+
+struct _DtmfEventRing
+{
+  guint mask;
+  gsize record_size;
+  guint8 *records;
+
+  /* Written by the producer only */
+  guint head __attribute__ ((aligned (CACHE_LINE)));
+  guint dropped;
+  gint fd;
+
+  /* Written by the consumer only */
+  guint tail __attribute__ ((aligned (CACHE_LINE)));
+};
+
+/* Ring of at least @size records of @record_size bytes */
+DtmfEventRing *
+dtmf_event_ring_new (guint size, gsize record_size)
+{
+  DtmfEventRing *ring = g_new0 (DtmfEventRing, 1);
+  guint n = 1;
+
+  size = CLAMP (size, 1, DTMF_EVENT_RING_MAX_SIZE);
+  while (n < size)
+    n <<= 1;
+
+  ring->mask = n - 1;
+  ring->record_size = record_size;
+  ring->records = g_malloc0 (n * record_size);
+  ring->fd = -1;
+
+  return ring;
+}
+
+void
+dtmf_event_ring_free (DtmfEventRing * ring)
+{
+  if (!ring)
+    return;
+
+  if (ring->fd >= 0)
+    close (ring->fd);
+  g_free (ring->records);
+  g_free (ring);
+}
+
+/* Append @record, from the producer thread. Returns FALSE and counts the
+ * record as dropped when the ring is full. */
+gboolean
+dtmf_event_ring_push (DtmfEventRing * ring, gconstpointer record)
+{
+  guint head = ring->head;
+  gint fd;
+
+  if (head - (guint) g_atomic_int_get (&ring->tail) > ring->mask) {
+    g_atomic_int_inc (&ring->dropped);
+    return FALSE;
+  }
+
+  memcpy (ring->records + (head & ring->mask) * ring->record_size, record,
+      ring->record_size);
+  /* Publishes the record, the store above is visible before the index */
+  g_atomic_int_set (&ring->head, head + 1);
+
+#ifdef __linux__
+  fd = g_atomic_int_get (&ring->fd);
+  if (fd >= 0)
+    eventfd_write (fd, 1);
+#else
+  (void) fd;
+#endif
+
+  return TRUE;
+}
+
+/* Take the oldest record into @record, from the consumer thread. Returns
+ * FALSE when the ring is empty. */
+gboolean
+dtmf_event_ring_pop (DtmfEventRing * ring, gpointer record)
+{
+  guint tail = ring->tail;
+
+  if ((guint) g_atomic_int_get (&ring->head) == tail)
+    return FALSE;
+
+  memcpy (record, ring->records + (tail & ring->mask) * ring->record_size,
+      ring->record_size);
+  /* Hands the slot back to the producer once it has been copied out */
+  g_atomic_int_set (&ring->tail, tail + 1);
+
+  return TRUE;
+}
+
+/* Records dropped because the ring was full */
+guint
+dtmf_event_ring_get_dropped (DtmfEventRing * ring)
+{
+  return g_atomic_int_get (&ring->dropped);
+}
+
+/* Descriptor that becomes readable when records are pushed, created on
+ * the first call. The consumer reads it to clear it and then pops until
+ * the ring is empty. Returns -1 where eventfd is not available. Only the
+ * consumer may call this. */
+gint
+dtmf_event_ring_get_fd (DtmfEventRing * ring)
+{
+#ifdef __linux__
+  if (ring->fd < 0)
+    g_atomic_int_set (&ring->fd, eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC));
+  return ring->fd;
+#else
+  return -1;
+#endif
+}
@@ -0,0 +1,45 @@
+/*
+ * GStreamer - DTMF PIN Source Detection Plugin for the Repeater Project
+ *
+ * Copyright 2025 Robert Hensel VK3DG vk3dg@gmail.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __DTMF_EVENT_RING_H__
+#define __DTMF_EVENT_RING_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Largest number of records a ring holds */
+#define DTMF_EVENT_RING_MAX_SIZE 4096
+
+typedef struct _DtmfEventRing DtmfEventRing;
+
+DtmfEventRing *dtmf_event_ring_new (guint size, gsize record_size);
+void dtmf_event_ring_free (DtmfEventRing * ring);
+
+gboolean dtmf_event_ring_push (DtmfEventRing * ring, gconstpointer record);
+gboolean dtmf_event_ring_pop (DtmfEventRing * ring, gpointer record);
+
+guint dtmf_event_ring_get_dropped (DtmfEventRing * ring);
+gint dtmf_event_ring_get_fd (DtmfEventRing * ring);
+
+G_END_DECLS
+
+#endif /* __DTMF_EVENT_RING_H__ */
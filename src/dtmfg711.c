@@ -0,0 +1,161 @@
+/*
+ * GStreamer - DTMF PIN Source Detection Plugin for the Repeater Project
+ *
+ * Copyright 2025 Robert Hensel VK3DG vk3dg@gmail.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * G.711 mu-law and A-law expansion for the detectors.
+ *
+ * Each law is a 256-entry table from the companded byte to the linear
+ * S16 sample, built once per process from the G.711 segment rules. The
+ * elements expand one analysis tick at a time straight from the input
+ * buffer, picking out a channel on the way, so there is no decoded copy
+ * of the buffer.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "dtmfg711.h"
+
+static gint16 ulaw_table[256];
+static gint16 alaw_table[256];
+
+static gint16
+ulaw_expand (guint8 u)
+{
+  gint t;
+
+  u = ~u;
+  t = ((u & 0x0f) << 3) + 0x84;
+  t <<= (u & 0x70) >> 4;
+
+  return (u & 0x80) ? 0x84 - t : t - 0x84;
+}
+
+static gint16
+alaw_expand (guint8 a)
+{
+  gint seg, t;
+
+  a ^= 0x55;
+  t = (a & 0x0f) << 4;
+  seg = (a & 0x70) >> 4;
+  if (seg == 0)
+    t += 8;
+  else
+    t = (t + 0x108) << (seg - 1);
+
+  return (a & 0x80) ? t : -t;
+}
+
+static void
+g711_init_once (void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized)) {
+    gint i;
+
+    for (i = 0; i < 256; i++) {
+      ulaw_table[i] = ulaw_expand (i);
+      alaw_table[i] = alaw_expand (i);
+    }
+    g_once_init_leave (&initialized, 1);
+  }
+}
+
+/* Expansion table of @law, NULL for linear input */
+const gint16 *
+dtmf_g711_table (DtmfG711Law law)
+{
+  g711_init_once ();
+
+  switch (law) {
+    case DTMF_G711_ULAW:
+      return ulaw_table;
+    case DTMF_G711_ALAW:
+      return alaw_table;
+    case DTMF_G711_NONE:
+    default:
+      return NULL;
+  }
+}
+
+/* Byte that decodes to silence in @law */
+guint8
+dtmf_g711_silence (DtmfG711Law law)
+{
+  switch (law) {
+    case DTMF_G711_ULAW:
+      return 0xff;
+    case DTMF_G711_ALAW:
+      return 0xd5;
+    case DTMF_G711_NONE:
+    default:
+      return 0;
+  }
+}
+
+/* Parse raw S16 or G.711 caps. G.711 is described as U8 in @info, which
+ * gets the frame size right for everything but the sample values. */
+gboolean
+dtmf_g711_info_from_caps (GstCaps * caps, GstAudioInfo * info,
+    DtmfG711Law * law)
+{
+  GstStructure *s = gst_caps_get_structure (caps, 0);
+  gint rate, channels;
+
+  if (gst_structure_has_name (s, "audio/x-mulaw"))
+    *law = DTMF_G711_ULAW;
+  else if (gst_structure_has_name (s, "audio/x-alaw"))
+    *law = DTMF_G711_ALAW;
+  else {
+    *law = DTMF_G711_NONE;
+    return gst_audio_info_from_caps (info, caps);
+  }
+
+  if (!gst_structure_get_int (s, "rate", &rate)
+      || !gst_structure_get_int (s, "channels", &channels))
+    return FALSE;
+
+  gst_audio_info_init (info);
+  gst_audio_info_set_format (info, GST_AUDIO_FORMAT_U8, rate, channels, NULL);
+
+  return TRUE;
+}
+
+/* Expand @n_frames samples of one channel of interleaved companded input,
+ * @in pointing at the channel's first byte, to S16 at @out */
+void
+dtmf_g711_expand (const gint16 * table, const guint8 * in, gsize n_frames,
+    gint channels, gint16 * out)
+{
+  gsize i;
+
+  if (channels == 1) {
+    for (i = 0; i < n_frames; i++)
+      out[i] = table[in[i]];
+    return;
+  }
+
+  for (i = 0; i < n_frames; i++)
+    out[i] = table[in[i * channels]];
+}
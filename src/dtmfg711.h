@@ -0,0 +1,47 @@
+/*
+ * GStreamer - DTMF PIN Source Detection Plugin for the Repeater Project
+ *
+ * Copyright 2025 Robert Hensel VK3DG vk3dg@gmail.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __DTMF_G711_H__
+#define __DTMF_G711_H__
+
+#include <gst/audio/audio.h>
+
+G_BEGIN_DECLS
+
+/* Companding of the input, DTMF_G711_NONE being linear S16 */
+typedef enum {
+  DTMF_G711_NONE,
+  DTMF_G711_ULAW,
+  DTMF_G711_ALAW
+} DtmfG711Law;
+
+const gint16 *dtmf_g711_table (DtmfG711Law law);
+guint8 dtmf_g711_silence (DtmfG711Law law);
+
+gboolean dtmf_g711_info_from_caps (GstCaps * caps, GstAudioInfo * info,
+    DtmfG711Law * law);
+
+void dtmf_g711_expand (const gint16 * table, const guint8 * in,
+    gsize n_frames, gint channels, gint16 * out);
+
+G_END_DECLS
+
+#endif /* __DTMF_G711_H__ */
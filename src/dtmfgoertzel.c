@@ -0,0 +1,376 @@
+/*
+ * GStreamer - DTMF PIN Source Detection Plugin for the Repeater Project
+ *
+ * Copyright 2025 Robert Hensel VK3DG vk3dg@gmail.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * In-tree DTMF detector built on a 16-filter Goertzel bank.
+ *
+ * The 8 DTMF frequencies and their second harmonics are evaluated together
+ * over 102-sample blocks, so a single SIMD recurrence covers the whole bank.
+ * The accept/reject rules (twist, relative peak, tone-to-total energy and
+ * the two-block debounce) follow spandsp's dtmf_rx. Each tone must reach
+ * -26 dBm0 where spandsp goes down to -42 dBm0, so digits at normal line
+ * levels come out the same but quiet ones are only found by spandsp.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "dtmfgoertzel.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+/* Twist and peak limits, matching spandsp's defaults. The level limit,
+ * DTMF_GOERTZEL_THRESHOLD_DBM0, is 16 dB above spandsp's. */
+#define DTMF_NORMAL_TWIST       6.309f  /* 8dB */
+#define DTMF_REVERSE_TWIST      2.512f  /* 4dB */
+#define DTMF_RELATIVE_PEAK      6.309f  /* 8dB */
+#define DTMF_TO_TOTAL_ENERGY    0.82f   /* fraction of a pure tone pair */
+#define DTMF_HARMONIC_RATIO     0.1f    /* 2nd harmonic 10dB down */
+
+static const gfloat dtmf_freqs[4 + 4] = {
+  697.0f, 770.0f, 852.0f, 941.0f, 1209.0f, 1336.0f, 1477.0f, 1633.0f
+};
+
+static const gchar dtmf_positions[] = "123A" "456B" "789C" "*0#D";
+
+typedef void (*GoertzelBlockFunc) (const gfloat * x, gint n,
+    const gfloat * coeffs, gfloat * power);
+
+struct _DtmfGoertzel
+{
+  gfloat block[DTMF_GOERTZEL_BLOCK];
+  gint fill;
+  gfloat energy;
+
+  DtmfGoertzelState state;
+
+  gfloat threshold;
+};
+
+/* 2cos(w) for rows, columns, row harmonics and column harmonics */
+static gfloat goertzel_coeffs[DTMF_GOERTZEL_FILTERS]
+    __attribute__ ((aligned (32)));
+static GoertzelBlockFunc goertzel_block = NULL;
+static const gchar *goertzel_kernel = "scalar";
+
+static void
+goertzel_block_scalar (const gfloat * x, gint n, const gfloat * coeffs,
+    gfloat * power)
+{
+  gfloat s1[DTMF_GOERTZEL_FILTERS] = { 0 };
+  gfloat s2[DTMF_GOERTZEL_FILTERS] = { 0 };
+  gint i, k;
+
+  for (i = 0; i < n; i++) {
+    for (k = 0; k < DTMF_GOERTZEL_FILTERS; k++) {
+      gfloat s0 = (x[i] - s2[k]) + coeffs[k] * s1[k];
+      s2[k] = s1[k];
+      s1[k] = s0;
+    }
+  }
+
+  for (k = 0; k < DTMF_GOERTZEL_FILTERS; k++)
+    power[k] = s1[k] * s1[k] + s2[k] * s2[k] - coeffs[k] * s1[k] * s2[k];
+}
+
+#ifdef HAVE_X86_DISPATCH
+__attribute__ ((target ("sse2")))
+static void
+goertzel_block_sse2 (const gfloat * x, gint n, const gfloat * coeffs,
+    gfloat * power)
+{
+  __m128 c[4], s1[4], s2[4];
+  gint i, k;
+
+  for (k = 0; k < 4; k++) {
+    c[k] = _mm_load_ps (coeffs + 4 * k);
+    s1[k] = _mm_setzero_ps ();
+    s2[k] = _mm_setzero_ps ();
+  }
+
+  for (i = 0; i < n; i++) {
+    __m128 xv = _mm_set1_ps (x[i]);
+
+    for (k = 0; k < 4; k++) {
+      __m128 s0 = _mm_add_ps (_mm_sub_ps (xv, s2[k]), _mm_mul_ps (c[k], s1[k]));
+      s2[k] = s1[k];
+      s1[k] = s0;
+    }
+  }
+
+  for (k = 0; k < 4; k++) {
+    __m128 p = _mm_add_ps (_mm_mul_ps (s1[k], s1[k]), _mm_mul_ps (s2[k], s2[k]));
+    p = _mm_sub_ps (p, _mm_mul_ps (c[k], _mm_mul_ps (s1[k], s2[k])));
+    _mm_storeu_ps (power + 4 * k, p);
+  }
+}
+
+__attribute__ ((target ("avx2")))
+static void
+goertzel_block_avx2 (const gfloat * x, gint n, const gfloat * coeffs,
+    gfloat * power)
+{
+  __m256 c0 = _mm256_load_ps (coeffs);
+  __m256 c1 = _mm256_load_ps (coeffs + 8);
+  __m256 a1 = _mm256_setzero_ps (), a2 = _mm256_setzero_ps ();
+  __m256 b1 = _mm256_setzero_ps (), b2 = _mm256_setzero_ps ();
+  __m256 p;
+  gint i;
+
+  for (i = 0; i < n; i++) {
+    __m256 xv = _mm256_set1_ps (x[i]);
+    __m256 a0 = _mm256_add_ps (_mm256_sub_ps (xv, a2), _mm256_mul_ps (c0, a1));
+    __m256 b0 = _mm256_add_ps (_mm256_sub_ps (xv, b2), _mm256_mul_ps (c1, b1));
+
+    a2 = a1;
+    a1 = a0;
+    b2 = b1;
+    b1 = b0;
+  }
+
+  p = _mm256_add_ps (_mm256_mul_ps (a1, a1), _mm256_mul_ps (a2, a2));
+  p = _mm256_sub_ps (p, _mm256_mul_ps (c0, _mm256_mul_ps (a1, a2)));
+  _mm256_storeu_ps (power, p);
+
+  p = _mm256_add_ps (_mm256_mul_ps (b1, b1), _mm256_mul_ps (b2, b2));
+  p = _mm256_sub_ps (p, _mm256_mul_ps (c1, _mm256_mul_ps (b1, b2)));
+  _mm256_storeu_ps (power + 8, p);
+}
+#endif
+
+static void
+goertzel_init_once (void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized)) {
+    gint k;
+
+    for (k = 0; k < 8; k++) {
+      goertzel_coeffs[k] =
+          2.0f * cosf (2.0f * G_PI * dtmf_freqs[k] / 8000.0f);
+      goertzel_coeffs[8 + k] =
+          2.0f * cosf (2.0f * G_PI * 2.0f * dtmf_freqs[k] / 8000.0f);
+    }
+
+    goertzel_block = goertzel_block_scalar;
+    goertzel_kernel = "scalar";
+#ifdef HAVE_X86_DISPATCH
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("avx2")) {
+      goertzel_block = goertzel_block_avx2;
+      goertzel_kernel = "avx2";
+    } else if (__builtin_cpu_supports ("sse2")) {
+      goertzel_block = goertzel_block_sse2;
+      goertzel_kernel = "sse2";
+    }
+#endif
+
+    g_once_init_leave (&initialized, 1);
+  }
+}
+
+/* Per-tone block power of a sine at the threshold level.
+ * A full scale sine is +3.14dBm0. */
+gfloat
+dtmf_goertzel_default_threshold (void)
+{
+  gfloat amplitude;
+
+  amplitude = 32767.0f * powf (10.0f,
+      (DTMF_GOERTZEL_THRESHOLD_DBM0 - 3.14f) / 20.0f);
+  amplitude *= DTMF_GOERTZEL_BLOCK / 2.0f;
+
+  return amplitude * amplitude;
+}
+
+const gfloat *
+dtmf_goertzel_coeffs (void)
+{
+  goertzel_init_once ();
+  return goertzel_coeffs;
+}
+
+DtmfGoertzel *
+dtmf_goertzel_new (void)
+{
+  DtmfGoertzel *g;
+
+  goertzel_init_once ();
+
+  g = g_new0 (DtmfGoertzel, 1);
+  g->threshold = dtmf_goertzel_default_threshold ();
+
+  dtmf_goertzel_reset (g);
+
+  return g;
+}
+
+void
+dtmf_goertzel_free (DtmfGoertzel * g)
+{
+  g_free (g);
+}
+
+void
+dtmf_goertzel_reset (DtmfGoertzel * g)
+{
+  g->fill = 0;
+  g->energy = 0.0f;
+  g->state.last_hit = 0;
+  g->state.in_digit = 0;
+}
+
+const gchar *
+dtmf_goertzel_kernel_name (void)
+{
+  goertzel_init_once ();
+  return goertzel_kernel;
+}
+
+/* Classify one block from its 16 filter powers, @stride floats apart.
+ * Returns the digit present, or 0 */
+gchar
+dtmf_goertzel_classify (const gfloat * power, gint stride, gfloat energy,
+    gfloat threshold)
+{
+  gfloat row[4], col[4], col2[4];
+  gint best_row = 0, best_col = 0;
+  gint i;
+
+  for (i = 0; i < 4; i++) {
+    row[i] = power[i * stride];
+    col[i] = power[(4 + i) * stride];
+    col2[i] = power[(12 + i) * stride];
+  }
+
+  for (i = 1; i < 4; i++) {
+    if (row[i] > row[best_row])
+      best_row = i;
+    if (col[i] > col[best_col])
+      best_col = i;
+  }
+
+  if (row[best_row] < threshold || col[best_col] < threshold)
+    return 0;
+
+  /* Twist: normal twist has the row (low group) tone louder */
+  if (row[best_row] > col[best_col] * DTMF_NORMAL_TWIST
+      || col[best_col] > row[best_row] * DTMF_REVERSE_TWIST)
+    return 0;
+
+  /* Relative peaks */
+  for (i = 0; i < 4; i++) {
+    if (i != best_row && row[i] * DTMF_RELATIVE_PEAK > row[best_row])
+      return 0;
+    if (i != best_col && col[i] * DTMF_RELATIVE_PEAK > col[best_col])
+      return 0;
+  }
+
+  /* Second harmonics reject speech. Only the column harmonics are usable:
+   * at this block length each row harmonic lies within one bin of a
+   * column tone. */
+  if (col2[best_col] > col[best_col] * DTMF_HARMONIC_RATIO)
+    return 0;
+
+  /* The tone pair must carry most of the block energy. A pure pair gives
+   * power / energy == block / 2. */
+  if (row[best_row] + col[best_col] <
+      DTMF_TO_TOTAL_ENERGY * (DTMF_GOERTZEL_BLOCK / 2.0f) * energy)
+    return 0;
+
+  return dtmf_positions[best_row * 4 + best_col];
+}
+
+/* Apply the two-block debounce. Returns a newly started digit, or 0 */
+gchar
+dtmf_goertzel_update (DtmfGoertzelState * state, gchar hit)
+{
+  gchar digit = 0;
+
+  /* Two successive blocks must agree before the state changes */
+  if (hit != state->in_digit && state->last_hit != state->in_digit) {
+    hit = (hit && hit == state->last_hit) ? hit : 0;
+    digit = hit;
+    state->in_digit = hit;
+  }
+  state->last_hit = hit;
+
+  return digit;
+}
+
+/* Feed 8 kHz samples. Detected digits are written to @digits, which is
+ * NUL terminated. Returns the number of digits. */
+gint
+dtmf_goertzel_process (DtmfGoertzel * g, const gint16 * samples,
+    gsize n_samples, gchar * digits, gint max_digits)
+{
+  gfloat power[DTMF_GOERTZEL_FILTERS];
+  gint count = 0;
+  gsize i = 0;
+
+  while (i < n_samples) {
+    gint chunk = MIN ((gsize) (DTMF_GOERTZEL_BLOCK - g->fill), n_samples - i);
+    gfloat *dst = g->block + g->fill;
+    gchar hit;
+    gint j;
+
+    for (j = 0; j < chunk; j++) {
+      gfloat x = samples[i + j];
+      dst[j] = x;
+      g->energy += x * x;
+    }
+    g->fill += chunk;
+    i += chunk;
+
+    if (g->fill < DTMF_GOERTZEL_BLOCK)
+      break;
+
+    goertzel_block (g->block, DTMF_GOERTZEL_BLOCK, goertzel_coeffs, power);
+
+    hit = dtmf_goertzel_classify (power, 1, g->energy, g->threshold);
+    hit = dtmf_goertzel_update (&g->state, hit);
+    if (hit && count < max_digits - 1)
+      digits[count++] = hit;
+
+    g->fill = 0;
+    g->energy = 0.0f;
+  }
+
+  if (max_digits > 0)
+    digits[count] = '\0';
+
+  return count;
+}
+
+/* Whether the last block held a tone or a digit is still sounding */
+gboolean
+dtmf_goertzel_in_tone (DtmfGoertzel * g)
+{
+  return g->state.in_digit != 0 || g->state.last_hit != 0;
+}
@@ -0,0 +1,66 @@
+/*
+ * GStreamer - DTMF PIN Source Detection Plugin for the Repeater Project
+ *
+ * Copyright 2025 Robert Hensel VK3DG vk3dg@gmail.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __DTMF_GOERTZEL_H__
+#define __DTMF_GOERTZEL_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Analysis block length at 8 kHz, same as spandsp */
+#define DTMF_GOERTZEL_BLOCK 102
+
+/* Filters per block: 4 rows, 4 columns and their second harmonics */
+#define DTMF_GOERTZEL_FILTERS 16
+
+/* Level in dBm0 each tone of a pair must reach, 16 dB less sensitive
+ * than spandsp's DTMF_DETECTOR_DEFAULT_THRESHOLD */
+#define DTMF_GOERTZEL_THRESHOLD_DBM0 (-26.0)
+
+typedef struct _DtmfGoertzel DtmfGoertzel;
+
+/* Two-block debounce state of one stream */
+typedef struct {
+  gchar last_hit;
+  gchar in_digit;
+} DtmfGoertzelState;
+
+DtmfGoertzel *dtmf_goertzel_new (void);
+void dtmf_goertzel_free (DtmfGoertzel * g);
+void dtmf_goertzel_reset (DtmfGoertzel * g);
+
+gint dtmf_goertzel_process (DtmfGoertzel * g, const gint16 * samples,
+    gsize n_samples, gchar * digits, gint max_digits);
+gboolean dtmf_goertzel_in_tone (DtmfGoertzel * g);
+
+const gchar *dtmf_goertzel_kernel_name (void);
+
+/* Building blocks shared with the batch engine */
+const gfloat *dtmf_goertzel_coeffs (void);
+gfloat dtmf_goertzel_default_threshold (void);
+gchar dtmf_goertzel_classify (const gfloat * power, gint stride,
+    gfloat energy, gfloat threshold);
+gchar dtmf_goertzel_update (DtmfGoertzelState * state, gchar hit);
+
+G_END_DECLS
+
+#endif /* __DTMF_GOERTZEL_H__ */
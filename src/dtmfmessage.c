@@ -0,0 +1,130 @@
+/*
+ * GStreamer - DTMF PIN Source Detection Plugin for the Repeater Project
+ *
+ * Copyright 2025 Robert Hensel VK3DG vk3dg@gmail.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Structures of the pin-detected and digit-detected bus messages.
+ *
+ * Field names are interned once, and strings that live for the whole
+ * process (function names, which the PIN table interns when it loads,
+ * digits and pad names) are referenced rather than copied. A message
+ * then costs the structure, a copy of the PIN and the message itself,
+ * and no lookups in the quark table.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "dtmfmessage.h"
+
+static GQuark quark_pin_detected;
+static GQuark quark_digit_detected;
+static GQuark quark_pin;
+static GQuark quark_function;
+static GQuark quark_valid;
+static GQuark quark_digit;
+static GQuark quark_channel;
+static GQuark quark_pad;
+static GQuark quark_timestamp;
+
+/* One NUL terminated string per character, for the digit field */
+static gchar digit_strings[128][2];
+
+/* Intern the field names, from the class_init of the elements */
+void
+dtmf_message_init (void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized)) {
+    gint c;
+
+    quark_pin_detected = g_quark_from_static_string ("pin-detected");
+    quark_digit_detected = g_quark_from_static_string ("digit-detected");
+    quark_pin = g_quark_from_static_string ("pin");
+    quark_function = g_quark_from_static_string ("function");
+    quark_valid = g_quark_from_static_string ("valid");
+    quark_digit = g_quark_from_static_string ("digit");
+    quark_channel = g_quark_from_static_string ("channel");
+    quark_pad = g_quark_from_static_string ("pad");
+    quark_timestamp = g_quark_from_static_string ("timestamp");
+
+    for (c = 0; c < 128; c++)
+      digit_strings[c][0] = c;
+
+    g_once_init_leave (&initialized, 1);
+  }
+}
+
+/* Set @field to @str without copying it, @str must outlive the structure */
+static void
+set_static_string (GstStructure * s, GQuark field, const gchar * str)
+{
+  GValue value = G_VALUE_INIT;
+
+  g_value_init (&value, G_TYPE_STRING);
+  g_value_set_static_string (&value, str);
+  gst_structure_id_take_value (s, field, &value);
+}
+
+/* The input is named by @pad when set, an interned or static name, and by
+ * @channel otherwise */
+static void
+set_source (GstStructure * s, gint channel, const gchar * pad)
+{
+  if (pad)
+    set_static_string (s, quark_pad, pad);
+  else
+    gst_structure_id_set (s, quark_channel, G_TYPE_INT, channel, NULL);
+}
+
+/* Structure of a pin-detected message. @function must be an interned
+ * string, as returned by the PIN table, or NULL. */
+GstStructure *
+dtmf_message_pin_detected (const gchar * pin, const gchar * function,
+    gboolean valid, gint channel, const gchar * pad, GstClockTime time)
+{
+  GstStructure *s;
+
+  s = gst_structure_new_id (quark_pin_detected,
+      quark_pin, G_TYPE_STRING, pin, NULL);
+  set_static_string (s, quark_function, function ? function : "");
+  gst_structure_id_set (s, quark_valid, G_TYPE_BOOLEAN, valid, NULL);
+  set_source (s, channel, pad);
+  gst_structure_id_set (s, quark_timestamp, G_TYPE_UINT64, time, NULL);
+
+  return s;
+}
+
+/* Structure of a digit-detected message */
+GstStructure *
+dtmf_message_digit_detected (gchar digit, gint channel, const gchar * pad,
+    GstClockTime time)
+{
+  GstStructure *s;
+
+  s = gst_structure_new_id_empty (quark_digit_detected);
+  set_static_string (s, quark_digit, digit_strings[digit & 0x7f]);
+  set_source (s, channel, pad);
+  gst_structure_id_set (s, quark_timestamp, G_TYPE_UINT64, time, NULL);
+
+  return s;
+}
@@ -0,0 +1,835 @@
+/*
+ * GStreamer - DTMF PIN Source Detection Plugin for the Repeater Project
+ *
+ * Copyright 2025 Robert Hensel VK3DG vk3dg@gmail.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * PIN database and per-stream PIN entry state, shared by dtmfpinsrc and
+ * dtmfpinmux.
+ *
+ * The PINs are compiled into a trie over the 16 DTMF symbols when the file
+ * is loaded. Entering a digit is a single step from the current node, so the
+ * cost per digit does not depend on how many PINs are configured, and a
+ * digit sequence that cannot lead to any PIN is recognised right away.
+ *
+ * A compiled table can be saved as a .pinx file: a fixed header followed by
+ * the trie nodes and the function pool, exactly as they are laid out in
+ * memory. Loading one maps the file read-only and points the table into the
+ * mapping, so there is no parsing and the pages are shared by every element
+ * and process using the same file.
+ *
+ * Elements open tables through a process-wide cache keyed by path, so any
+ * number of elements naming the same file share one table. A cached table
+ * is reused only while the file's device, inode, size and modification time
+ * are unchanged. The cache holds no reference: a table leaves it when the
+ * last element lets go.
+ *
+ * A reloaded table is handed to the streaming thread through a single
+ * pointer slot (dtmf_pin_table_publish/take). The streaming thread owns the
+ * table it matches against and only swaps at a buffer boundary, rebasing
+ * the partial entries onto the new trie, so matching never takes a lock
+ * and the old table is freed once nothing can still be walking it.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "dtmfpin.h"
+
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <string.h>
+
+GST_DEBUG_CATEGORY_EXTERN (dtmf_pin_src_debug);
+#define GST_CAT_DEFAULT (dtmf_pin_src_debug)
+
+struct _DtmfPinTable
+{
+  gint refcount;
+  gint pin_count;
+
+  /* Compiled trie, node 0 is the root */
+  const DtmfPinNode *nodes;
+  guint n_nodes;
+
+  /* Function names, NUL separated. Only a name that is actually reported
+   * is copied into the GLib string table, see function_name() */
+  const gchar *functions;
+  gsize functions_size;
+
+  /* Backing .pinx file, NULL when nodes and functions are allocated */
+  GMappedFile *mapped;
+
+  /* Cache key and the file identity it was loaded from, NULL if the table
+   * is not in the cache */
+  gchar *cache_path;
+  guint64 dev;
+  guint64 ino;
+  gint64 mtime;                 /* ns */
+  gint64 size;
+};
+
+/* Tables by path, without a reference. cache_lock guards the hash table and
+ * is only held briefly, also when a streaming thread drops the last
+ * reference. load_lock serialises opening so each file is parsed once even
+ * when many elements start together. */
+static GMutex cache_lock;
+static GMutex load_lock;
+static GHashTable *table_cache;
+
+/* .pinx file header, followed by n_nodes DtmfPinNode and the function pool.
+ * Integers are in host byte order, byte_order tells a foreign file apart. */
+#define PINX_MAGIC "DTMFPINX"
+#define PINX_VERSION 1
+#define PINX_BYTE_ORDER 0x01020304
+
+typedef struct {
+  gchar magic[8];
+  guint32 version;
+  guint32 byte_order;
+  guint32 pin_count;
+  guint32 n_nodes;
+  guint64 functions_size;
+  guint32 checksum;             /* over nodes and function pool */
+  guint32 reserved;
+} PinxHeader;
+
+G_STATIC_ASSERT (sizeof (DtmfPinNode) == 12);
+G_STATIC_ASSERT (sizeof (PinxHeader) == 40);
+
+/* A PIN while the table is being built. Keys are stored as symbol + 1 so
+ * they sort with strcmp and a shorter PIN sorts before its extensions. */
+typedef struct {
+  guint32 key;                  /* offset in the key arena */
+  guint32 function;             /* offset in the function pool */
+} PinRecord;
+
+/* Map a DTMF digit to its trie symbol, -1 if it is not a DTMF digit */
+static inline gint
+digit_symbol (gchar digit)
+{
+  switch (digit) {
+    case '0': case '1': case '2': case '3': case '4':
+    case '5': case '6': case '7': case '8': case '9':
+      return digit - '0';
+    case '*':
+      return 10;
+    case '#':
+      return 11;
+    case 'A': case 'B': case 'C': case 'D':
+      return 12 + digit - 'A';
+    case 'a': case 'b': case 'c': case 'd':
+      return 12 + digit - 'a';
+    default:
+      return -1;
+  }
+}
+
+/* Append @pin to @keys as a symbol key, FALSE if it is not all DTMF digits */
+static gboolean
+append_key (GString * keys, const gchar * pin)
+{
+  gsize start = keys->len;
+
+  for (; *pin; pin++) {
+    gint sym = digit_symbol (*pin);
+
+    if (sym < 0) {
+      g_string_truncate (keys, start);
+      return FALSE;
+    }
+    g_string_append_c (keys, (gchar) (sym + 1));
+  }
+  g_string_append_c (keys, '\0');
+  return TRUE;
+}
+
+/* Ties keep file order so the first of several identical PINs wins */
+static gint
+compare_records (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+  const gchar *keys = user_data;
+  const PinRecord *ra = a;
+  const PinRecord *rb = b;
+  gint r = strcmp (keys + ra->key, keys + rb->key);
+
+  if (r)
+    return r;
+  return (ra->key > rb->key) - (ra->key < rb->key);
+}
+
+/* Symbol + 1 at @depth of a record's key, 0 at the end */
+#define KEY_AT(rec, depth) ((guchar) keys[(rec).key + (depth)])
+
+/* Fill in @node for the sorted records[lo..hi) which share their first
+ * @depth digits, appending its children to @nodes */
+static void
+build_node (GArray * nodes, guint node, const PinRecord * records,
+    const gchar * keys, gsize lo, gsize hi, gint depth)
+{
+  DtmfPinNode *n;
+  guint16 mask = 0;
+  guint first_child;
+  gint n_children = 0;
+  gsize i, start;
+
+  /* PINs ending here sort first, only the first one counts */
+  i = lo;
+  if (i < hi && KEY_AT (records[i], depth) == 0) {
+    g_array_index (nodes, DtmfPinNode, node).function = records[i].function;
+    while (i < hi && KEY_AT (records[i], depth) == 0)
+      i++;
+  }
+  start = i;
+
+  for (; i < hi; i++) {
+    gint sym = KEY_AT (records[i], depth) - 1;
+
+    if (!(mask & (1 << sym))) {
+      mask |= 1 << sym;
+      n_children++;
+    }
+  }
+
+  first_child = nodes->len;
+  g_array_set_size (nodes, first_child + n_children);
+  for (i = 0; i < (gsize) n_children; i++) {
+    n = &g_array_index (nodes, DtmfPinNode, first_child + i);
+    n->child_mask = 0;
+    n->reserved = 0;
+    n->first_child = 0;
+    n->function = -1;
+  }
+
+  n = &g_array_index (nodes, DtmfPinNode, node);
+  n->child_mask = mask;
+  n->first_child = first_child;
+
+  /* One child per run of PINs with the same next digit */
+  for (i = start; i < hi;) {
+    guchar sym = KEY_AT (records[i], depth);
+    gsize end = i + 1;
+
+    while (end < hi && KEY_AT (records[end], depth) == sym)
+      end++;
+
+    build_node (nodes, first_child++, records, keys, i, end, depth + 1);
+    i = end;
+  }
+}
+
+/* Compile the loaded PINs into the trie */
+static void
+build_trie (DtmfPinTable * table, GArray * records, GString * keys)
+{
+  GArray *nodes = g_array_new (FALSE, FALSE, sizeof (DtmfPinNode));
+  DtmfPinNode root = { 0, 0, 0, -1 };
+
+  g_array_sort_with_data (records, compare_records, keys->str);
+
+  g_array_append_val (nodes, root);
+  build_node (nodes, 0, (const PinRecord *) records->data, keys->str, 0,
+      records->len, 0);
+
+  table->n_nodes = nodes->len;
+  table->nodes = (DtmfPinNode *) g_array_free (nodes, FALSE);
+}
+
+static const DtmfPinNode root_node[1] = { {0, 0, 0, -1} };
+
+/* Empty table, matches nothing */
+DtmfPinTable *
+dtmf_pin_table_new (void)
+{
+  DtmfPinTable *table = g_new0 (DtmfPinTable, 1);
+
+  table->refcount = 1;
+  table->n_nodes = 1;
+  table->nodes = root_node;
+  return table;
+}
+
+DtmfPinTable *
+dtmf_pin_table_ref (DtmfPinTable * table)
+{
+  g_atomic_int_inc (&table->refcount);
+  return table;
+}
+
+void
+dtmf_pin_table_unref (DtmfPinTable * table)
+{
+  if (table && g_atomic_int_dec_and_test (&table->refcount)) {
+    if (table->cache_path) {
+      g_mutex_lock (&cache_lock);
+      if (g_hash_table_lookup (table_cache, table->cache_path) == table)
+        g_hash_table_remove (table_cache, table->cache_path);
+      g_mutex_unlock (&cache_lock);
+      g_free (table->cache_path);
+    }
+
+    if (table->mapped) {
+      g_mapped_file_unref (table->mapped);
+    } else {
+      if (table->nodes != root_node)
+        g_free ((gpointer) table->nodes);
+      g_free ((gpointer) table->functions);
+    }
+    g_free (table);
+  }
+}
+
+/* Interned copy of the function name at @offset, for a match about to be
+ * reported. Bus messages reference the name instead of copying it, so it
+ * has to outlive the table; interning on demand keeps names that are never
+ * matched, and the mapped pool of a .pinx file, out of the string table. */
+static const gchar *
+function_name (const DtmfPinTable * table, guint32 offset)
+{
+  return g_intern_string (table->functions + offset);
+}
+
+/* Offset of @function in @pool, adding it the first time it is seen */
+static guint32
+intern_function (GHashTable * interned, GString * pool, const gchar * function)
+{
+  gpointer offset;
+
+  if (g_hash_table_lookup_extended (interned, function, NULL, &offset))
+    return GPOINTER_TO_UINT (offset);
+
+  offset = GUINT_TO_POINTER (pool->len);
+  g_string_append_len (pool, function, strlen (function) + 1);
+  g_hash_table_insert (interned, g_strdup (function), offset);
+  return GPOINTER_TO_UINT (offset);
+}
+
+/* Parse a codes.pin text file */
+static DtmfPinTable *
+table_new_from_text (GstObject * owner, const gchar * filename)
+{
+  DtmfPinTable *table;
+  FILE *file;
+  gchar line[512];
+  gint line_num = 0;
+  GArray *records;
+  GString *keys;
+  GString *pool;
+  GHashTable *interned;
+
+  file = fopen (filename, "r");
+  if (!file) {
+    GST_WARNING_OBJECT (owner, "Could not open PIN config file: %s", filename);
+    return NULL;
+  }
+
+  records = g_array_new (FALSE, FALSE, sizeof (PinRecord));
+  keys = g_string_new (NULL);
+  pool = g_string_new (NULL);
+  interned = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  while (fgets (line, sizeof (line), file)) {
+    PinRecord rec;
+
+    line_num++;
+
+    /* Remove trailing newline */
+    line[strcspn (line, "\r\n")] = 0;
+
+    /* Skip empty lines and comments */
+    if (line[0] == '\0' || line[0] == ';')
+      continue;
+
+    /* Parse PIN=function format */
+    gchar *equal = strchr (line, '=');
+    if (!equal) {
+      GST_WARNING_OBJECT (owner, "Invalid line %d: missing '='", line_num);
+      continue;
+    }
+
+    *equal = '\0';
+    gchar *pin = g_strstrip (line);
+    gchar *function = g_strstrip (equal + 1);
+
+    if (strlen (pin) == 0 || strlen (function) == 0) {
+      GST_WARNING_OBJECT (owner, "Invalid line %d: empty PIN or function",
+          line_num);
+      continue;
+    }
+
+    if (strlen (pin) > MAX_PIN_LENGTH) {
+      GST_WARNING_OBJECT (owner, "Line %d: PIN too long (max %d)", line_num,
+          MAX_PIN_LENGTH);
+      continue;
+    }
+
+    rec.key = keys->len;
+    if (!append_key (keys, pin)) {
+      GST_WARNING_OBJECT (owner, "Line %d: PIN contains non-DTMF digits",
+          line_num);
+      continue;
+    }
+    rec.function = intern_function (interned, pool, function);
+    g_array_append_val (records, rec);
+
+    GST_LOG_OBJECT (owner, "Loaded PIN: %s -> %s", pin, function);
+  }
+
+  fclose (file);
+
+  table = g_new0 (DtmfPinTable, 1);
+  table->refcount = 1;
+  table->pin_count = records->len;
+  build_trie (table, records, keys);
+  table->functions_size = pool->len;
+  table->functions = g_string_free (pool, FALSE);
+
+  GST_INFO_OBJECT (owner, "Loaded %d PIN codes from %s (%u trie nodes, "
+      "%u distinct functions)", table->pin_count, filename, table->n_nodes,
+      g_hash_table_size (interned));
+
+  g_hash_table_destroy (interned);
+  g_string_free (keys, TRUE);
+  g_array_free (records, TRUE);
+
+  return table;
+}
+
+/* Fletcher style checksum over 32-bit words */
+static guint32
+pinx_checksum (const guint8 * data, gsize size)
+{
+  guint64 a = 1, b = 0;
+  gsize i;
+
+  for (i = 0; i + 4 <= size; i += 4) {
+    guint32 w;
+
+    memcpy (&w, data + i, 4);
+    a += w;
+    b += a;
+  }
+  for (; i < size; i++) {
+    a += data[i];
+    b += a;
+  }
+
+  return (guint32) (a ^ (a >> 32) ^ ((b * G_GUINT64_CONSTANT (0x9E3779B97F4A7C15)) >> 32));
+}
+
+/* Check that every node only refers to nodes and strings inside the file,
+ * so a damaged file can never make a lookup read out of bounds */
+static gboolean
+pinx_nodes_valid (const DtmfPinNode * nodes, guint n_nodes,
+    gsize functions_size)
+{
+  guint i;
+
+  for (i = 0; i < n_nodes; i++) {
+    const DtmfPinNode *n = &nodes[i];
+
+    if (n->child_mask && (n->first_child <= i
+            || (guint64) n->first_child + __builtin_popcount (n->child_mask) >
+            n_nodes))
+      return FALSE;
+    if (n->function < -1 || (n->function >= 0
+            && (gsize) n->function >= functions_size))
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* Use a mapped .pinx file in place */
+static DtmfPinTable *
+table_new_from_pinx (GstObject * owner, const gchar * filename,
+    GMappedFile * mapped)
+{
+  const gchar *data = g_mapped_file_get_contents (mapped);
+  gsize size = g_mapped_file_get_length (mapped);
+  const DtmfPinNode *nodes;
+  const gchar *functions;
+  DtmfPinTable *table;
+  PinxHeader header;
+  gsize nodes_size;
+
+  if (size < sizeof (header)) {
+    GST_WARNING_OBJECT (owner, "%s: truncated header", filename);
+    return NULL;
+  }
+  memcpy (&header, data, sizeof (header));
+
+  if (header.byte_order != PINX_BYTE_ORDER) {
+    GST_WARNING_OBJECT (owner, "%s: compiled on a host with another byte "
+        "order, recompile it with dtmfpin-compile", filename);
+    return NULL;
+  }
+  if (header.version != PINX_VERSION) {
+    GST_WARNING_OBJECT (owner, "%s: unsupported version %u", filename,
+        header.version);
+    return NULL;
+  }
+
+  nodes_size = (gsize) header.n_nodes * sizeof (DtmfPinNode);
+  if (header.n_nodes == 0 || header.functions_size > G_MAXINT32
+      || size != sizeof (header) + nodes_size + header.functions_size) {
+    GST_WARNING_OBJECT (owner, "%s: size does not match header", filename);
+    return NULL;
+  }
+
+  nodes = (const DtmfPinNode *) (data + sizeof (header));
+  functions = data + sizeof (header) + nodes_size;
+
+  if (pinx_checksum ((const guint8 *) nodes,
+          nodes_size + header.functions_size) != header.checksum) {
+    GST_WARNING_OBJECT (owner, "%s: checksum mismatch", filename);
+    return NULL;
+  }
+  if ((header.functions_size && functions[header.functions_size - 1] != '\0')
+      || !pinx_nodes_valid (nodes, header.n_nodes, header.functions_size)) {
+    GST_WARNING_OBJECT (owner, "%s: corrupt index", filename);
+    return NULL;
+  }
+
+  table = g_new0 (DtmfPinTable, 1);
+  table->refcount = 1;
+  table->pin_count = header.pin_count;
+  table->nodes = nodes;
+  table->n_nodes = header.n_nodes;
+  table->functions = functions;
+  table->functions_size = header.functions_size;
+  table->mapped = g_mapped_file_ref (mapped);
+
+  GST_INFO_OBJECT (owner, "Mapped %d PIN codes from %s (%u trie nodes)",
+      table->pin_count, filename, table->n_nodes);
+  return table;
+}
+
+/* Load PIN configuration from a codes.pin text file or a compiled .pinx
+ * file, told apart by the .pinx magic. Returns NULL if the file cannot be
+ * opened or the .pinx file is damaged. */
+DtmfPinTable *
+dtmf_pin_table_new_from_file (GstObject * owner, const gchar * filename)
+{
+  GMappedFile *mapped;
+  DtmfPinTable *table;
+
+  mapped = g_mapped_file_new (filename, FALSE, NULL);
+  if (mapped && g_mapped_file_get_length (mapped) >= strlen (PINX_MAGIC)
+      && memcmp (g_mapped_file_get_contents (mapped), PINX_MAGIC,
+          strlen (PINX_MAGIC)) == 0) {
+    table = table_new_from_pinx (owner, filename, mapped);
+    g_mapped_file_unref (mapped);
+    return table;
+  }
+
+  if (mapped)
+    g_mapped_file_unref (mapped);
+
+  return table_new_from_text (owner, filename);
+}
+
+/* Reference @table unless its last reference is already gone */
+static gboolean
+ref_if_alive (DtmfPinTable * table)
+{
+  gint ref;
+
+  do {
+    ref = g_atomic_int_get (&table->refcount);
+    if (ref == 0)
+      return FALSE;
+  } while (!g_atomic_int_compare_and_exchange (&table->refcount, ref,
+          ref + 1));
+
+  return TRUE;
+}
+
+/* Modification time of @st in nanoseconds, so a file rewritten within the
+ * same second still counts as changed where the system keeps finer times */
+static gint64
+stat_mtime (const GStatBuf * st)
+{
+  gint64 mtime = (gint64) st->st_mtime * G_GINT64_CONSTANT (1000000000);
+
+#ifdef __linux__
+  mtime += st->st_mtim.tv_nsec;
+#endif
+
+  return mtime;
+}
+
+/* Cached table for @filename if it is still current, with a reference */
+static DtmfPinTable *
+cache_lookup (const gchar * filename, const GStatBuf * st)
+{
+  DtmfPinTable *table;
+
+  g_mutex_lock (&cache_lock);
+  table = table_cache ? g_hash_table_lookup (table_cache, filename) : NULL;
+  if (table && (table->dev != (guint64) st->st_dev
+          || table->ino != (guint64) st->st_ino
+          || table->mtime != stat_mtime (st)
+          || table->size != (gint64) st->st_size || !ref_if_alive (table)))
+    table = NULL;
+  g_mutex_unlock (&cache_lock);
+
+  return table;
+}
+
+/* Open the PIN table for @filename through the process-wide cache. Returns
+ * a shared table with a new reference, or NULL if the file cannot be read.
+ * Tables are immutable, so sharing is invisible to the caller. */
+DtmfPinTable *
+dtmf_pin_table_open (GstObject * owner, const gchar * filename)
+{
+  DtmfPinTable *table;
+  GStatBuf st;
+
+  if (g_stat (filename, &st) != 0) {
+    GST_WARNING_OBJECT (owner, "Could not open PIN config file: %s",
+        filename);
+    return NULL;
+  }
+
+  table = cache_lookup (filename, &st);
+  if (table) {
+    GST_DEBUG_OBJECT (owner, "Sharing cached PIN table for %s", filename);
+    return table;
+  }
+
+  g_mutex_lock (&load_lock);
+
+  /* Another element may have loaded it while we waited */
+  table = cache_lookup (filename, &st);
+  if (!table) {
+    table = dtmf_pin_table_new_from_file (owner, filename);
+    if (table) {
+      table->cache_path = g_strdup (filename);
+      table->dev = st.st_dev;
+      table->ino = st.st_ino;
+      table->mtime = stat_mtime (&st);
+      table->size = st.st_size;
+
+      /* Replaces a stale table for the same path, which then stays out of
+       * the cache until its last user drops it */
+      g_mutex_lock (&cache_lock);
+      if (!table_cache)
+        table_cache = g_hash_table_new (g_str_hash, g_str_equal);
+      g_hash_table_replace (table_cache, table->cache_path, table);
+      g_mutex_unlock (&cache_lock);
+    }
+  }
+
+  g_mutex_unlock (&load_lock);
+
+  return table;
+}
+
+/* Offer @table to a streaming thread through @slot, taking over the
+ * reference. A table published earlier and not yet taken is dropped. */
+void
+dtmf_pin_table_publish (DtmfPinTable ** slot, DtmfPinTable * table)
+{
+  DtmfPinTable *old;
+
+  do {
+    old = g_atomic_pointer_get (slot);
+  } while (!g_atomic_pointer_compare_and_exchange (slot, old, table));
+
+  dtmf_pin_table_unref (old);
+}
+
+/* Take the table published in @slot, or NULL. Lock free, meant for the
+ * streaming thread, which is the only one taking from its slot. */
+DtmfPinTable *
+dtmf_pin_table_take (DtmfPinTable ** slot)
+{
+  DtmfPinTable *table;
+
+  do {
+    table = g_atomic_pointer_get (slot);
+    if (!table)
+      return NULL;
+  } while (!g_atomic_pointer_compare_and_exchange (slot, table, NULL));
+
+  return table;
+}
+
+/* Write @table as a .pinx file */
+gboolean
+dtmf_pin_table_save (const DtmfPinTable * table, const gchar * filename,
+    GError ** error)
+{
+  gsize nodes_size = (gsize) table->n_nodes * sizeof (DtmfPinNode);
+  gsize size = sizeof (PinxHeader) + nodes_size + table->functions_size;
+  PinxHeader header;
+  gchar *data;
+  gboolean ret;
+
+  memset (&header, 0, sizeof (header));
+  memcpy (header.magic, PINX_MAGIC, sizeof (header.magic));
+  header.version = PINX_VERSION;
+  header.byte_order = PINX_BYTE_ORDER;
+  header.pin_count = table->pin_count;
+  header.n_nodes = table->n_nodes;
+  header.functions_size = table->functions_size;
+
+  data = g_malloc (size);
+  memcpy (data + sizeof (header), table->nodes, nodes_size);
+  if (table->functions_size)
+    memcpy (data + sizeof (header) + nodes_size, table->functions,
+        table->functions_size);
+  header.checksum = pinx_checksum ((const guint8 *) data + sizeof (header),
+      nodes_size + table->functions_size);
+  memcpy (data, &header, sizeof (header));
+
+  /* Written to a temporary file and renamed, so elements that still map
+   * the old file keep a consistent copy */
+  ret = g_file_set_contents (filename, data, size, error);
+  g_free (data);
+
+  return ret;
+}
+
+gint
+dtmf_pin_table_size (const DtmfPinTable * table)
+{
+  return table->pin_count;
+}
+
+guint
+dtmf_pin_table_n_nodes (const DtmfPinTable * table)
+{
+  return table->n_nodes;
+}
+
+/* Bytes used by the compiled table */
+gsize
+dtmf_pin_table_memory_size (const DtmfPinTable * table)
+{
+  return sizeof (DtmfPinTable) + table->n_nodes * sizeof (DtmfPinNode)
+      + table->functions_size;
+}
+
+/* Child of @node for @digit, or -1 */
+static inline gint64
+trie_step (const DtmfPinTable * table, guint32 node, gchar digit)
+{
+  const DtmfPinNode *n = &table->nodes[node];
+  gint sym = digit_symbol (digit);
+
+  if (sym < 0 || !(n->child_mask & (1 << sym)))
+    return -1;
+
+  return n->first_child + __builtin_popcount (n->child_mask & ((1 << sym) - 1));
+}
+
+/* Returns the function configured for @pin, or NULL. The string belongs to
+ * @table. */
+const gchar *
+dtmf_pin_table_lookup (const DtmfPinTable * table, const gchar * pin)
+{
+  gint64 node = 0;
+
+  for (; *pin && node >= 0; pin++)
+    node = trie_step (table, node, *pin);
+
+  if (node < 0 || table->nodes[node].function < 0)
+    return NULL;
+
+  return table->functions + table->nodes[node].function;
+}
+
+void
+dtmf_pin_entry_reset (DtmfPinEntry * entry)
+{
+  memset (entry->buffer, 0, sizeof (entry->buffer));
+  entry->position = 0;
+  entry->node = 0;
+}
+
+/* Append @digit and advance one trie node. On a match @function is set to
+ * the configured function name, an interned string that outlives the
+ * table. The entry is left as is, the caller resets
+ * it after reporting a match or a dead end. */
+DtmfPinResult
+dtmf_pin_entry_push (DtmfPinEntry * entry, const DtmfPinTable * table,
+    gchar digit, const gchar ** function)
+{
+  gint64 next;
+
+  *function = NULL;
+
+  if (entry->position < PIN_BUFFER_SIZE - 1) {
+    entry->buffer[entry->position++] = digit;
+    entry->buffer[entry->position] = '\0';
+  }
+
+  /* The table may have been replaced since the entry started */
+  if (entry->node >= table->n_nodes)
+    return DTMF_PIN_DEAD_END;
+
+  next = trie_step (table, entry->node, digit);
+  if (next < 0)
+    return DTMF_PIN_DEAD_END;
+
+  entry->node = next;
+  if (table->nodes[next].function >= 0) {
+    *function = function_name (table, table->nodes[next].function);
+    return DTMF_PIN_MATCH;
+  }
+
+  return DTMF_PIN_PREFIX;
+}
+
+/* Move a partial entry onto @table after the PIN table was replaced, by
+ * walking its digits again. PREFIX means the entry carries on, MATCH that
+ * the digits so far are a PIN of the new table (@function is set) and
+ * DEAD_END that no PIN of the new table starts with them. The caller
+ * resets the entry after MATCH or DEAD_END, as after a push. */
+DtmfPinResult
+dtmf_pin_entry_rebase (DtmfPinEntry * entry, const DtmfPinTable * table,
+    const gchar ** function)
+{
+  gint64 node = 0;
+  gint i;
+
+  *function = NULL;
+  entry->node = 0;
+
+  for (i = 0; i < entry->position; i++) {
+    /* A shorter PIN would have matched earlier */
+    if (table->nodes[node].function >= 0)
+      return DTMF_PIN_DEAD_END;
+
+    node = trie_step (table, node, entry->buffer[i]);
+    if (node < 0)
+      return DTMF_PIN_DEAD_END;
+  }
+
+  entry->node = node;
+  if (entry->position > 0 && table->nodes[node].function >= 0) {
+    *function = function_name (table, table->nodes[node].function);
+    return DTMF_PIN_MATCH;
+  }
+
+  return DTMF_PIN_PREFIX;
+}
@@ -0,0 +1,92 @@
+/*
+ * GStreamer - DTMF PIN Source Detection Plugin for the Repeater Project
+ *
+ * Copyright 2025 Robert Hensel VK3DG vk3dg@gmail.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __DTMF_PIN_H__
+#define __DTMF_PIN_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define MAX_PIN_LENGTH 16
+#define PIN_BUFFER_SIZE 64
+
+/* Number of distinct DTMF symbols: 0-9, *, #, A-D */
+#define DTMF_PIN_SYMBOLS 16
+
+/* Node of the compiled digit trie. Children of a node are stored next to
+ * each other, the child for symbol s is at
+ * first_child + popcount (child_mask & ((1 << s) - 1)). */
+typedef struct {
+  guint16 child_mask;
+  guint16 reserved;             /* zero, keeps the .pinx layout explicit */
+  guint32 first_child;
+  gint32 function;              /* offset of the function name, or -1 */
+} DtmfPinNode;
+
+/* PIN database compiled into a trie, with the function names interned in
+ * one string pool. Loaded either from a codes.pin text file or from a
+ * .pinx file written by dtmf_pin_table_save(), which is mapped read-only
+ * and used in place. Immutable once built and reference counted so one
+ * table can be shared by several streams. */
+typedef struct _DtmfPinTable DtmfPinTable;
+
+/* Digits entered so far on one stream */
+typedef struct {
+  gchar buffer[PIN_BUFFER_SIZE];
+  gint position;
+  guint32 node;                 /* current trie node, 0 is the root */
+} DtmfPinEntry;
+
+typedef enum {
+  DTMF_PIN_MATCH,               /* a configured PIN was completed */
+  DTMF_PIN_PREFIX,              /* digits so far start at least one PIN */
+  DTMF_PIN_DEAD_END             /* no PIN starts with the digits so far */
+} DtmfPinResult;
+
+DtmfPinTable *dtmf_pin_table_new (void);
+DtmfPinTable *dtmf_pin_table_new_from_file (GstObject * owner,
+    const gchar * filename);
+DtmfPinTable *dtmf_pin_table_open (GstObject * owner, const gchar * filename);
+DtmfPinTable *dtmf_pin_table_ref (DtmfPinTable * table);
+void dtmf_pin_table_unref (DtmfPinTable * table);
+
+void dtmf_pin_table_publish (DtmfPinTable ** slot, DtmfPinTable * table);
+DtmfPinTable *dtmf_pin_table_take (DtmfPinTable ** slot);
+
+gboolean dtmf_pin_table_save (const DtmfPinTable * table,
+    const gchar * filename, GError ** error);
+
+gint dtmf_pin_table_size (const DtmfPinTable * table);
+guint dtmf_pin_table_n_nodes (const DtmfPinTable * table);
+gsize dtmf_pin_table_memory_size (const DtmfPinTable * table);
+const gchar *dtmf_pin_table_lookup (const DtmfPinTable * table,
+    const gchar * pin);
+
+void dtmf_pin_entry_reset (DtmfPinEntry * entry);
+DtmfPinResult dtmf_pin_entry_push (DtmfPinEntry * entry,
+    const DtmfPinTable * table, gchar digit, const gchar ** function);
+DtmfPinResult dtmf_pin_entry_rebase (DtmfPinEntry * entry,
+    const DtmfPinTable * table, const gchar ** function);
+
+G_END_DECLS
+
+#endif /* __DTMF_PIN_H__ */
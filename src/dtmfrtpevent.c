@@ -0,0 +1,150 @@
+/*
+ * GStreamer - DTMF PIN Source Detection Plugin for the Repeater Project
+ *
+ * Copyright 2025 Robert Hensel VK3DG vk3dg@gmail.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+/*
+ * Out-of-band DTMF: RFC 4733 telephone-event packets and GstDTMF events.
+ *
+ * An RFC 4733 sender repeats the packet of an event while the key is held
+ * and sends its end packet three times, all with the RTP timestamp of the
+ * start of the event. A DtmfRtpEventState remembers the event in progress
+ * so each of them yields its digit once, whichever of its packets arrives
+ * first. An event too long for the 16-bit duration field goes on in
+ * segments without the end bit, each starting where the previous one's
+ * duration ran out; those continue the same key press. The RTP header is
+ * read by hand; only the fixed header, CSRCs, extension and padding have
+ * to be skipped to reach the event.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "dtmfrtpevent.h"
+
+/* Fixed RTP header and RFC 4733 event block sizes */
+#define RTP_HEADER_SIZE 12
+#define EVENT_BLOCK_SIZE 4
+
+static const gchar event_digits[] = "0123456789*#ABCD";
+
+void
+dtmf_rtp_event_state_reset (DtmfRtpEventState * state)
+{
+  state->active = FALSE;
+  state->ssrc = 0;
+  state->timestamp = 0;
+  state->event = 0;
+  state->duration = 0;
+  state->ended = FALSE;
+}
+
+/* Digit of RFC 4733 event code @event, 0 for the events that are not DTMF */
+gchar
+dtmf_rtp_event_digit (gint event)
+{
+  if (event < 0 || event >= (gint) sizeof (event_digits) - 1)
+    return 0;
+
+  return event_digits[event];
+}
+
+/* Parse the RTP packet @data of @size bytes. Returns the digit of the
+ * event it carries when that event is new to @state, 0 for repeats, end
+ * packets and further segments of events already seen and anything that
+ * is not a valid DTMF telephone-event packet. */
+gchar
+dtmf_rtp_event_parse (DtmfRtpEventState * state, const guint8 * data,
+    gsize size)
+{
+  gsize offset = RTP_HEADER_SIZE;
+  gsize padding = 0;
+  guint32 ssrc, timestamp;
+  guint16 duration;
+  guint8 event;
+  gboolean end;
+
+  if (size < RTP_HEADER_SIZE || (data[0] >> 6) != 2)
+    return 0;
+
+  offset += (data[0] & 0x0f) * 4;
+  if (data[0] & 0x10) {
+    if (offset + 4 > size)
+      return 0;
+    offset += 4 + GST_READ_UINT16_BE (data + offset + 2) * 4;
+  }
+  if (data[0] & 0x20)
+    padding = data[size - 1];
+
+  if (offset + padding + EVENT_BLOCK_SIZE > size)
+    return 0;
+
+  timestamp = GST_READ_UINT32_BE (data + 4);
+  ssrc = GST_READ_UINT32_BE (data + 8);
+  event = data[offset];
+  end = (data[offset + 1] & 0x80) != 0;
+  duration = GST_READ_UINT16_BE (data + offset + 2);
+
+  if (state->active && state->ssrc == ssrc) {
+    /* Repeat or end packet of the event in progress */
+    if (state->timestamp == timestamp) {
+      state->duration = MAX (state->duration, duration);
+      state->ended |= end;
+      return 0;
+    }
+
+    /* Next segment of a long event */
+    if (!state->ended && state->event == event
+        && timestamp == (guint32) (state->timestamp + state->duration)) {
+      state->timestamp = timestamp;
+      state->duration = duration;
+      state->ended = end;
+      return 0;
+    }
+  }
+
+  state->active = TRUE;
+  state->ssrc = ssrc;
+  state->timestamp = timestamp;
+  state->event = event;
+  state->duration = duration;
+  state->ended = end;
+
+  return dtmf_rtp_event_digit (event);
+}
+
+/* Digit of the start of a GstDTMF "dtmf-event", as sent to dtmfsrc and
+ * posted by rtpdtmfdepay, 0 for a stop or any other structure */
+gchar
+dtmf_rtp_event_from_structure (const GstStructure * s)
+{
+  gboolean start;
+  gint number;
+
+  if (!s || !gst_structure_has_name (s, "dtmf-event"))
+    return 0;
+
+  if (!gst_structure_get_boolean (s, "start", &start) || !start
+      || !gst_structure_get_int (s, "number", &number))
+    return 0;
+
+  return dtmf_rtp_event_digit (number);
+}
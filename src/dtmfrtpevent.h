@@ -0,0 +1,49 @@
+/*
+ * GStreamer - DTMF PIN Source Detection Plugin for the Repeater Project
+ *
+ * Copyright 2025 Robert Hensel VK3DG vk3dg@gmail.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __DTMF_RTP_EVENT_H__
+#define __DTMF_RTP_EVENT_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* Event in progress on an RFC 4733 stream */
+typedef struct {
+  gboolean active;
+  guint32 ssrc;
+  guint32 timestamp;
+  guint8 event;
+  guint16 duration;             /* longest seen for timestamp */
+  gboolean ended;               /* an end packet was seen */
+} DtmfRtpEventState;
+
+void dtmf_rtp_event_state_reset (DtmfRtpEventState * state);
+
+gchar dtmf_rtp_event_digit (gint event);
+gchar dtmf_rtp_event_parse (DtmfRtpEventState * state, const guint8 * data,
+    gsize size);
+gchar dtmf_rtp_event_from_structure (const GstStructure * s);
+
+G_END_DECLS
+
+#endif /* __DTMF_RTP_EVENT_H__ */
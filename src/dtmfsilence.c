@@ -0,0 +1,115 @@
+/*
+ * GStreamer - DTMF PIN Source Detection Plugin for the Repeater Project
+ *
+ * Copyright 2025 Robert Hensel VK3DG vk3dg@gmail.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Silent output buffers.
+ *
+ * All silence handed downstream is backed by one read-only block of zeros
+ * shared by the whole process. A silent buffer of any length is a list of
+ * shared views of that block, so muting a stream neither allocates nor
+ * writes sample memory, and the buffers are flagged GAP so that downstream
+ * elements can skip them as well. Companded formats, whose silence is not
+ * zero, get a block of their own silence byte the first time it is asked
+ * for.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "dtmfsilence.h"
+
+#include <string.h>
+
+/* 1s of 32 kHz stereo S16, enough for most buffers in one view */
+#define SILENCE_SIZE (128 * 1024)
+
+static const guint8 zeros[SILENCE_SIZE];
+static GstMemory *silence = NULL;
+
+/* Blocks of other fill bytes, created on first use */
+static GMutex filled_lock;
+static GstMemory *filled[256];
+
+static GstMemory *
+silence_memory (void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized)) {
+    silence = gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY,
+        (gpointer) zeros, SILENCE_SIZE, 0, SILENCE_SIZE, NULL, NULL);
+    GST_MINI_OBJECT_FLAG_SET (silence, GST_MINI_OBJECT_FLAG_MAY_BE_LEAKED);
+    g_once_init_leave (&initialized, 1);
+  }
+
+  return silence;
+}
+
+static GstMemory *
+filled_memory (guint8 value)
+{
+  GstMemory *mem;
+
+  if (value == 0)
+    return silence_memory ();
+
+  g_mutex_lock (&filled_lock);
+  mem = filled[value];
+  if (!mem) {
+    guint8 *data = g_malloc (SILENCE_SIZE);
+
+    memset (data, value, SILENCE_SIZE);
+    mem = gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY, data,
+        SILENCE_SIZE, 0, SILENCE_SIZE, data, g_free);
+    GST_MINI_OBJECT_FLAG_SET (mem, GST_MINI_OBJECT_FLAG_MAY_BE_LEAKED);
+    filled[value] = mem;
+  }
+  g_mutex_unlock (&filled_lock);
+
+  return mem;
+}
+
+/* New GAP buffer of @size zero bytes, without timestamps */
+GstBuffer *
+dtmf_silence_buffer_new (gsize size)
+{
+  return dtmf_silence_buffer_new_filled (size, 0);
+}
+
+/* New GAP buffer of @size bytes of @value, for formats whose silence is
+ * not zero */
+GstBuffer *
+dtmf_silence_buffer_new_filled (gsize size, guint8 value)
+{
+  GstMemory *mem = filled_memory (value);
+  GstBuffer *buf = gst_buffer_new ();
+
+  while (size > 0) {
+    gsize chunk = MIN (size, SILENCE_SIZE);
+
+    gst_buffer_append_memory (buf, gst_memory_share (mem, 0, chunk));
+    size -= chunk;
+  }
+
+  GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_GAP);
+  return buf;
+}
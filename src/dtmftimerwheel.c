@@ -0,0 +1,432 @@
+/*
+ * GStreamer - DTMF PIN Source Detection Plugin for the Repeater Project
+ *
+ * Copyright 2025 Robert Hensel VK3DG vk3dg@gmail.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Process-wide hierarchical timer wheel.
+ *
+ * Deadlines are in g_get_monotonic_time() microseconds and are rounded up
+ * to ticks of the wheel resolution. LEVELS wheels of SLOTS slots each hold
+ * the scheduled timers; level 0 covers the next SLOTS ticks and each
+ * level above covers SLOTS times the span of the one below. When level 0
+ * wraps, the due slot of the next level is spread out over the levels
+ * below, so adding, cancelling and expiring a timer is O(1).
+ *
+ * One thread runs a GMainContext of its own and advances the wheel from a
+ * timeout source. The source only exists while timers are scheduled, so an
+ * idle process never wakes up, however many timers exist. Callbacks run
+ * on that thread without the wheel lock held and may schedule, cancel or
+ * free timers themselves.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "dtmftimerwheel.h"
+
+#define LEVEL_BITS 6
+#define SLOTS (1 << LEVEL_BITS)
+#define SLOT_MASK (SLOTS - 1)
+#define LEVELS 4
+
+/* Longest delay the wheel holds, later deadlines are clamped to it */
+#define MAX_TICKS ((G_GUINT64_CONSTANT (1) << (LEVELS * LEVEL_BITS)) - 1)
+
+struct _DtmfTimer
+{
+  /* Slot list, pprev points at the pointer that points to this timer */
+  DtmfTimer *next;
+  DtmfTimer **pprev;
+
+  gint64 deadline;
+  guint64 expires;              /* deadline in ticks */
+  gint scheduled;               /* atomic, for dtmf_timer_is_scheduled */
+
+  DtmfTimerFunc func;
+  gpointer user_data;
+};
+
+static GMutex wheel_lock;
+static GCond wheel_cond;
+
+static DtmfTimer *slots[LEVELS][SLOTS];
+static guint64 current;         /* next tick to expire */
+static guint n_scheduled;
+static guint n_timers;
+static guint resolution = DTMF_TIMER_WHEEL_DEFAULT_RESOLUTION;
+
+static GThread *thread = NULL;
+static GMainContext *context = NULL;
+static GMainLoop *loop = NULL;
+static GSource *tick_source = NULL;
+
+/* Timer whose callback is running on the wheel thread */
+static DtmfTimer *running = NULL;
+
+static guint64
+tick_of (gint64 time)
+{
+  return (guint64) MAX (time, 0) / (resolution * 1000);
+}
+
+static void
+unlink_timer (DtmfTimer * timer)
+{
+  *timer->pprev = timer->next;
+  if (timer->next)
+    timer->next->pprev = timer->pprev;
+  timer->next = NULL;
+  timer->pprev = NULL;
+}
+
+static void
+link_timer (DtmfTimer * timer, DtmfTimer ** head)
+{
+  timer->next = *head;
+  if (timer->next)
+    timer->next->pprev = &timer->next;
+  timer->pprev = head;
+  *head = timer;
+}
+
+/* Put @timer in the slot of the lowest level that reaches its tick */
+static void
+insert_timer (DtmfTimer * timer)
+{
+  guint64 expires = MAX (timer->expires, current);
+  guint64 delta = expires - current;
+  gint level = 0;
+
+  if (delta > MAX_TICKS) {
+    expires = current + MAX_TICKS;
+    delta = MAX_TICKS;
+  }
+
+  while (level < LEVELS - 1 && delta >> ((level + 1) * LEVEL_BITS))
+    level++;
+
+  link_timer (timer, &slots[level][(expires >> (level * LEVEL_BITS))
+          & SLOT_MASK]);
+}
+
+/* Spread the timers of a slot over the levels below */
+static void
+cascade (gint level, guint slot)
+{
+  DtmfTimer *list = slots[level][slot];
+
+  slots[level][slot] = NULL;
+  if (list)
+    list->pprev = &list;
+
+  while (list) {
+    DtmfTimer *timer = list;
+
+    unlink_timer (timer);
+    insert_timer (timer);
+  }
+}
+
+static void
+stop_tick_source (void)
+{
+  if (tick_source) {
+    g_source_destroy (tick_source);
+    g_source_unref (tick_source);
+    tick_source = NULL;
+  }
+}
+
+static gboolean advance_wheel (gpointer data);
+
+static void
+start_tick_source (void)
+{
+  tick_source = g_timeout_source_new (resolution);
+  g_source_set_callback (tick_source, advance_wheel, NULL, NULL);
+  g_source_attach (tick_source, context);
+}
+
+/* Expire every tick up to now, running the callbacks of due timers */
+static gboolean
+advance_wheel (gpointer data)
+{
+  guint64 now;
+
+  g_mutex_lock (&wheel_lock);
+
+  now = tick_of (g_get_monotonic_time ());
+  while (current <= now && n_scheduled > 0) {
+    guint slot = current & SLOT_MASK;
+    DtmfTimer *due;
+    gint level;
+
+    for (level = 1; slot == 0 && level < LEVELS; level++) {
+      slot = (current >> (level * LEVEL_BITS)) & SLOT_MASK;
+      cascade (level, slot);
+    }
+
+    due = slots[0][current & SLOT_MASK];
+    slots[0][current & SLOT_MASK] = NULL;
+    if (due)
+      due->pprev = &due;
+    current++;
+
+    while (due) {
+      DtmfTimer *timer = due;
+
+      unlink_timer (timer);
+      g_atomic_int_set (&timer->scheduled, FALSE);
+      n_scheduled--;
+
+      running = timer;
+      g_mutex_unlock (&wheel_lock);
+      timer->func (timer->user_data);
+      g_mutex_lock (&wheel_lock);
+      running = NULL;
+      g_cond_broadcast (&wheel_cond);
+    }
+  }
+
+  /* A callback may have replaced or stopped this source */
+  if (tick_source != g_main_current_source ()) {
+    g_mutex_unlock (&wheel_lock);
+    return G_SOURCE_REMOVE;
+  }
+
+  if (n_scheduled == 0) {
+    /* Nothing to wait for, dtmf_timer_schedule() catches current up when
+     * the next timer comes in */
+    g_source_unref (tick_source);
+    tick_source = NULL;
+    g_mutex_unlock (&wheel_lock);
+    return G_SOURCE_REMOVE;
+  }
+
+  g_mutex_unlock (&wheel_lock);
+  return G_SOURCE_CONTINUE;
+}
+
+static gpointer
+wheel_thread (gpointer data)
+{
+  GMainLoop *thread_loop = data;
+  GMainContext *thread_context = g_main_loop_get_context (thread_loop);
+
+  g_main_context_push_thread_default (thread_context);
+  g_main_loop_run (thread_loop);
+  g_main_context_pop_thread_default (thread_context);
+  g_main_loop_unref (thread_loop);
+  return NULL;
+}
+
+static gboolean
+quit_loop (gpointer data)
+{
+  g_main_loop_quit (data);
+  return G_SOURCE_REMOVE;
+}
+
+/* Create a timer. The wheel thread is started with the first one. */
+DtmfTimer *
+dtmf_timer_new (DtmfTimerFunc func, gpointer user_data)
+{
+  DtmfTimer *timer = g_new0 (DtmfTimer, 1);
+
+  timer->func = func;
+  timer->user_data = user_data;
+
+  g_mutex_lock (&wheel_lock);
+  if (n_timers++ == 0) {
+    current = tick_of (g_get_monotonic_time ());
+    context = g_main_context_new ();
+    loop = g_main_loop_new (context, FALSE);
+    thread = g_thread_new ("dtmftimerwheel", wheel_thread,
+        g_main_loop_ref (loop));
+  }
+  g_mutex_unlock (&wheel_lock);
+
+  return timer;
+}
+
+/* Cancel and free @timer. When its callback is running on another thread,
+ * this waits for it to return, so the callback data can be freed next. */
+void
+dtmf_timer_free (DtmfTimer * timer)
+{
+  GThread *stop = NULL;
+  GMainLoop *stop_loop = NULL;
+  GMainContext *stop_context = NULL;
+
+  if (!timer)
+    return;
+
+  g_mutex_lock (&wheel_lock);
+  if (timer->pprev) {
+    unlink_timer (timer);
+    n_scheduled--;
+  }
+  while (running == timer && g_thread_self () != thread)
+    g_cond_wait (&wheel_cond, &wheel_lock);
+
+  if (--n_timers == 0) {
+    stop_tick_source ();
+    stop = thread;
+    stop_loop = loop;
+    stop_context = context;
+    thread = NULL;
+    loop = NULL;
+    context = NULL;
+  }
+  g_mutex_unlock (&wheel_lock);
+
+  if (stop) {
+    GSource *quit = g_idle_source_new ();
+
+    /* Quit from inside the loop, it may not be running yet */
+    g_source_set_callback (quit, quit_loop, g_main_loop_ref (stop_loop),
+        (GDestroyNotify) g_main_loop_unref);
+    g_source_attach (quit, stop_context);
+    g_source_unref (quit);
+
+    /* The last timer freed from its own callback leaves the thread to
+     * finish on its own */
+    if (stop != g_thread_self ())
+      g_thread_join (stop);
+    else
+      g_thread_unref (stop);
+    g_main_loop_unref (stop_loop);
+    g_main_context_unref (stop_context);
+  }
+
+  g_free (timer);
+}
+
+/* Run @timer once g_get_monotonic_time() reaches @deadline, replacing any
+ * earlier deadline */
+void
+dtmf_timer_schedule (DtmfTimer * timer, gint64 deadline)
+{
+  g_mutex_lock (&wheel_lock);
+
+  /* An empty wheel may not have advanced for a long time. Start from the
+   * present, or the next tick would walk every slot since then under the
+   * lock, and the MAX_TICKS clamp would count from a stale tick and fire
+   * far deadlines early. */
+  if (n_scheduled == 0)
+    current = MAX (current, tick_of (g_get_monotonic_time ()));
+
+  if (timer->pprev)
+    unlink_timer (timer);
+  else
+    n_scheduled++;
+
+  timer->deadline = deadline;
+  /* Round up, a timer never fires early */
+  timer->expires = tick_of (deadline + resolution * 1000 - 1);
+  insert_timer (timer);
+  g_atomic_int_set (&timer->scheduled, TRUE);
+
+  if (!tick_source)
+    start_tick_source ();
+
+  g_mutex_unlock (&wheel_lock);
+}
+
+void
+dtmf_timer_cancel (DtmfTimer * timer)
+{
+  g_mutex_lock (&wheel_lock);
+  if (timer->pprev) {
+    unlink_timer (timer);
+    n_scheduled--;
+    g_atomic_int_set (&timer->scheduled, FALSE);
+  }
+  g_mutex_unlock (&wheel_lock);
+}
+
+/* Whether @timer waits to fire. Lock free, for callers that only want to
+ * schedule when it does not. */
+gboolean
+dtmf_timer_is_scheduled (DtmfTimer * timer)
+{
+  return g_atomic_int_get (&timer->scheduled);
+}
+
+/* Change the tick length of the wheel, for all timers in the process */
+void
+dtmf_timer_wheel_set_resolution (guint resolution_ms)
+{
+  DtmfTimer *pending = NULL;
+  gint level, slot;
+
+  resolution_ms = CLAMP (resolution_ms, DTMF_TIMER_WHEEL_MIN_RESOLUTION,
+      DTMF_TIMER_WHEEL_MAX_RESOLUTION);
+
+  g_mutex_lock (&wheel_lock);
+
+  if (resolution_ms == resolution) {
+    g_mutex_unlock (&wheel_lock);
+    return;
+  }
+
+  /* Take every timer out and put it back in ticks of the new length */
+  for (level = 0; level < LEVELS; level++) {
+    for (slot = 0; slot < SLOTS; slot++) {
+      while (slots[level][slot]) {
+        DtmfTimer *timer = slots[level][slot];
+
+        unlink_timer (timer);
+        link_timer (timer, &pending);
+      }
+    }
+  }
+
+  resolution = resolution_ms;
+  current = tick_of (g_get_monotonic_time ());
+
+  while (pending) {
+    DtmfTimer *timer = pending;
+
+    unlink_timer (timer);
+    timer->expires = tick_of (timer->deadline + resolution * 1000 - 1);
+    insert_timer (timer);
+  }
+
+  if (tick_source) {
+    stop_tick_source ();
+    start_tick_source ();
+  }
+
+  g_mutex_unlock (&wheel_lock);
+}
+
+guint
+dtmf_timer_wheel_get_resolution (void)
+{
+  guint res;
+
+  g_mutex_lock (&wheel_lock);
+  res = resolution;
+  g_mutex_unlock (&wheel_lock);
+
+  return res;
+}
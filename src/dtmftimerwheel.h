@@ -0,0 +1,51 @@
+/*
+ * GStreamer - DTMF PIN Source Detection Plugin for the Repeater Project
+ *
+ * Copyright 2025 Robert Hensel VK3DG vk3dg@gmail.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __DTMF_TIMER_WHEEL_H__
+#define __DTMF_TIMER_WHEEL_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Default and allowed expiry resolution of the shared wheel */
+#define DTMF_TIMER_WHEEL_DEFAULT_RESOLUTION 50
+#define DTMF_TIMER_WHEEL_MIN_RESOLUTION 1
+#define DTMF_TIMER_WHEEL_MAX_RESOLUTION 1000
+
+typedef struct _DtmfTimer DtmfTimer;
+
+/* Called on the wheel thread once the deadline has passed */
+typedef void (*DtmfTimerFunc) (gpointer user_data);
+
+DtmfTimer *dtmf_timer_new (DtmfTimerFunc func, gpointer user_data);
+void dtmf_timer_free (DtmfTimer * timer);
+
+void dtmf_timer_schedule (DtmfTimer * timer, gint64 deadline);
+void dtmf_timer_cancel (DtmfTimer * timer);
+gboolean dtmf_timer_is_scheduled (DtmfTimer * timer);
+
+void dtmf_timer_wheel_set_resolution (guint resolution_ms);
+guint dtmf_timer_wheel_get_resolution (void);
+
+G_END_DECLS
+
+#endif /* __DTMF_TIMER_WHEEL_H__ */
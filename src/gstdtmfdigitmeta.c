@@ -0,0 +1,114 @@
+/*
+ * GStreamer - DTMF PIN Source Detection Plugin for the Repeater Project
+ *
+ * Copyright 2025 Robert Hensel VK3DG vk3dg@gmail.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Per-digit detection results carried on buffers.
+ *
+ * Bus messages reach the application through its main loop, some time
+ * after the audio they describe. The meta travels with the audio instead,
+ * so elements and appsinks downstream see each digit in the streaming
+ * thread, on the buffer it was recognised with.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstdtmfdigitmeta.h"
+
+GType
+gst_dtmf_digit_meta_api_get_type (void)
+{
+  static GType type = 0;
+  static const gchar *tags[] = { NULL };
+
+  if (g_once_init_enter (&type)) {
+    GType _type = gst_meta_api_type_register ("GstDtmfDigitMetaAPI", tags);
+    g_once_init_leave (&type, _type);
+  }
+  return type;
+}
+
+static gboolean
+gst_dtmf_digit_meta_init (GstMeta * meta, gpointer params, GstBuffer * buffer)
+{
+  GstDtmfDigitMeta *dmeta = (GstDtmfDigitMeta *) meta;
+
+  dmeta->digit = 0;
+  dmeta->channel = 0;
+  dmeta->start = 0;
+  dmeta->end = 0;
+  dmeta->timestamp = GST_CLOCK_TIME_NONE;
+
+  return TRUE;
+}
+
+/* The digit stays with the buffer through copies, whatever part of it is
+ * copied; the sample offsets refer to the stream, not to the buffer */
+static gboolean
+gst_dtmf_digit_meta_transform (GstBuffer * dest, GstMeta * meta,
+    GstBuffer * buffer, GQuark type, gpointer data)
+{
+  GstDtmfDigitMeta *dmeta = (GstDtmfDigitMeta *) meta;
+
+  if (!GST_META_TRANSFORM_IS_COPY (type))
+    return FALSE;
+
+  return gst_buffer_add_dtmf_digit_meta (dest, dmeta->digit, dmeta->channel,
+      dmeta->start, dmeta->end, dmeta->timestamp) != NULL;
+}
+
+const GstMetaInfo *
+gst_dtmf_digit_meta_get_info (void)
+{
+  static const GstMetaInfo *meta_info = NULL;
+
+  if (g_once_init_enter ((GstMetaInfo **) & meta_info)) {
+    const GstMetaInfo *mi = gst_meta_register (GST_DTMF_DIGIT_META_API_TYPE,
+        "GstDtmfDigitMeta", sizeof (GstDtmfDigitMeta),
+        gst_dtmf_digit_meta_init, NULL, gst_dtmf_digit_meta_transform);
+    g_once_init_leave ((GstMetaInfo **) & meta_info, (GstMetaInfo *) mi);
+  }
+  return meta_info;
+}
+
+/* Attach a digit to @buffer, which must be writable */
+GstDtmfDigitMeta *
+gst_buffer_add_dtmf_digit_meta (GstBuffer * buffer, gchar digit,
+    gint channel, guint64 start, guint64 end, GstClockTime timestamp)
+{
+  GstDtmfDigitMeta *meta;
+
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), NULL);
+
+  meta = (GstDtmfDigitMeta *) gst_buffer_add_meta (buffer,
+      GST_DTMF_DIGIT_META_INFO, NULL);
+  if (!meta)
+    return NULL;
+
+  meta->digit = digit;
+  meta->channel = channel;
+  meta->start = start;
+  meta->end = end;
+  meta->timestamp = timestamp;
+
+  return meta;
+}
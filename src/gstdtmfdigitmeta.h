@@ -0,0 +1,72 @@
+/*
+ * GStreamer - DTMF PIN Source Detection Plugin for the Repeater Project
+ *
+ * Copyright 2025 Robert Hensel VK3DG vk3dg@gmail.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_DTMF_DIGIT_META_H__
+#define __GST_DTMF_DIGIT_META_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstDtmfDigitMeta GstDtmfDigitMeta;
+
+/**
+ * GstDtmfDigitMeta:
+ * @meta: parent #GstMeta
+ * @digit: the DTMF digit, one of 0-9, *, # and A-D
+ * @channel: input channel the digit was detected on
+ * @start: first sample of the audio the digit was recognised in
+ * @end: sample after the last one of that audio
+ * @timestamp: running time at which the digit counts as entered, the same
+ *   as in the digit-detected message
+ *
+ * A digit recognised by dtmfpinsrc, attached to the buffer that leaves the
+ * element when it is recognised. A buffer carries one meta per digit.
+ * Sample offsets are at the input rate and counted from the start of the
+ * stream or the last flush or discontinuity.
+ */
+struct _GstDtmfDigitMeta
+{
+  GstMeta meta;
+
+  gchar digit;
+  gint channel;
+  guint64 start;
+  guint64 end;
+  GstClockTime timestamp;
+};
+
+GType gst_dtmf_digit_meta_api_get_type (void);
+#define GST_DTMF_DIGIT_META_API_TYPE (gst_dtmf_digit_meta_api_get_type ())
+
+const GstMetaInfo *gst_dtmf_digit_meta_get_info (void);
+#define GST_DTMF_DIGIT_META_INFO (gst_dtmf_digit_meta_get_info ())
+
+#define gst_buffer_get_dtmf_digit_meta(b) \
+  ((GstDtmfDigitMeta *) gst_buffer_get_meta ((b), GST_DTMF_DIGIT_META_API_TYPE))
+
+GstDtmfDigitMeta *gst_buffer_add_dtmf_digit_meta (GstBuffer * buffer,
+    gchar digit, gint channel, guint64 start, guint64 end,
+    GstClockTime timestamp);
+
+G_END_DECLS
+
+#endif /* __GST_DTMF_DIGIT_META_H__ */
@@ -0,0 +1,1162 @@
+/*
+ * GStreamer - DTMF PIN Source Detection Plugin for the Repeater Project
+ *
+ * Copyright 2025 Robert Hensel VK3DG vk3dg@gmail.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/**
+ * SECTION:element-dtmfpinmux
+ * @title: dtmfpinmux
+ * @short_description: Detects DTMF PIN codes on many inputs at once
+ *
+ * Multi-input sibling of dtmfpinsrc. Every `sink_%u` request pad is an
+ * independent call leg with its own detector and PIN entry state, while the
+ * PIN configuration is loaded once and shared by all of them. Detection for
+ * all pads runs on the aggregator thread, or on a small pool of worker
+ * threads when `worker-threads` is greater than one, so a large number of
+ * legs only costs a handful of threads.
+ *
+ * Inputs accept the same formats as dtmfpinsrc. The audio is consumed; the
+ * source pad carries 8000 Hz mono silence flagged as GAP to keep downstream
+ * sinks and the pipeline clock running.
+ *
+ * The element posts the same `pin-detected` bus messages as dtmfpinsrc with
+ * one extra field:
+ *
+ * * gchar `pin`: The detected PIN code
+ * * gchar `function`: The function name associated with the PIN
+ * * gboolean `valid`: Whether the PIN was valid
+ * * gchar `pad`: Name of the sink pad the PIN was entered on
+ *
+ * Properties:
+ * * gchar `config-file`: Path to the PIN configuration file, either a codes.pin
+ *   text file or a .pinx index written by dtmfpin-compile
+ * * gboolean `auto-reload`: Reload the PIN configuration when the file changes
+ *   on disk (default: FALSE)
+ * * guint `inter-digit-timeout`: Timeout between digits in milliseconds (default: 3000)
+ * * guint `entry-timeout`: Timeout for complete PIN entry in milliseconds (default: 10000)
+ * * GstDtmfPinSrcDetector `detector`: DTMF detection engine (default: spandsp)
+ * * gboolean `energy-gate`: Skip the detector on blocks that cannot hold a
+ *   tone pair, as on dtmfpinsrc (default: FALSE)
+ * * guint `worker-threads`: Threads running detection, 1 uses the aggregator
+ *   thread only. Applied when the element starts (default: 1)
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 dtmfpinmux name=mux config-file=codes.pin ! fakesink \
+ *   filesrc location=a.wav ! wavparse ! mux.sink_0 \
+ *   filesrc location=b.wav ! wavparse ! mux.sink_1
+ * ]|
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstdtmfpinmux.h"
+#include "dtmfsilence.h"
+#include "dtmfmessage.h"
+#include "dtmfg711.h"
+#include "dtmfdeinterleave.h"
+#include "gstdtmfpinsrc.h"
+
+#include <string.h>
+
+GST_DEBUG_CATEGORY_STATIC (dtmf_pin_mux_debug);
+#define GST_CAT_DEFAULT (dtmf_pin_mux_debug)
+
+/* Inputs take the same formats as dtmfpinsrc */
+#define DTMF_PIN_MUX_SINK_CAPS \
+    "audio/x-raw, " \
+    "format = (string) { " GST_AUDIO_NE (S16) ", " GST_AUDIO_NE (S32) ", " \
+    GST_AUDIO_NE (F32) " }, " \
+    "rate = (int) { 8000, 16000, 32000, 44100, 48000 }, " \
+    "channels = (int) { 1, 2 }, " \
+    "layout = (string) interleaved; " \
+    "audio/x-mulaw, " \
+    "rate = (int) 8000, " \
+    "channels = (int) { 1, 2 }; " \
+    "audio/x-alaw, " \
+    "rate = (int) 8000, " \
+    "channels = (int) { 1, 2 }"
+
+#define DTMF_PIN_MUX_SRC_CAPS \
+    "audio/x-raw, " \
+    "format = (string) " GST_AUDIO_NE (S16) ", " \
+    "rate = (int) 8000, " \
+    "channels = (int) 1, " \
+    "layout = (string) interleaved"
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink_%u",
+    GST_PAD_SINK,
+    GST_PAD_REQUEST,
+    GST_STATIC_CAPS (DTMF_PIN_MUX_SINK_CAPS)
+    );
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (DTMF_PIN_MUX_SRC_CAPS)
+    );
+
+/* Properties */
+enum
+{
+  PROP_0,
+  PROP_CONFIG_FILE,
+  PROP_INTER_DIGIT_TIMEOUT,
+  PROP_ENTRY_TIMEOUT,
+  PROP_DETECTOR,
+  PROP_WORKER_THREADS,
+  PROP_AUTO_RELOAD,
+  PROP_POST_DIGITS,
+  PROP_ENERGY_GATE
+};
+
+#define DEFAULT_DETECTOR DTMF_DETECTOR_ENGINE_SPANDSP
+#define DEFAULT_WORKER_THREADS 1
+
+/* Output advanced on a live timeout when no input has data */
+#define TIMEOUT_GAP_DURATION (20 * GST_MSECOND)
+
+static void gst_dtmf_pin_mux_finalize (GObject * object);
+static void stop_file_monitor (GstDtmfPinMux * self);
+static void gst_dtmf_pin_mux_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_dtmf_pin_mux_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+
+static gboolean gst_dtmf_pin_mux_start (GstAggregator * agg);
+static gboolean gst_dtmf_pin_mux_stop (GstAggregator * agg);
+static gboolean gst_dtmf_pin_mux_sink_event (GstAggregator * agg,
+    GstAggregatorPad * aggpad, GstEvent * event);
+static GstFlowReturn gst_dtmf_pin_mux_aggregate (GstAggregator * agg,
+    gboolean timeout);
+
+static void gst_dtmf_pin_mux_pad_finalize (GObject * object);
+static GstFlowReturn gst_dtmf_pin_mux_pad_flush (GstAggregatorPad * aggpad,
+    GstAggregator * agg);
+
+static void reset_pin_entry (GstDtmfPinMuxPad * pad);
+static void process_pad (GstDtmfPinMux * self, GstDtmfPinMuxPad * pad);
+static void flush_detector (GstDtmfPinMux * self, GstDtmfPinMuxPad * pad);
+static void expire_entry (GstDtmfPinMux * self, GstDtmfPinMuxPad * pad);
+
+G_DEFINE_TYPE (GstDtmfPinMuxPad, gst_dtmf_pin_mux_pad,
+    GST_TYPE_AGGREGATOR_PAD);
+
+G_DEFINE_TYPE (GstDtmfPinMux, gst_dtmf_pin_mux, GST_TYPE_AGGREGATOR);
+
+/* Pad class initialization */
+static void
+gst_dtmf_pin_mux_pad_class_init (GstDtmfPinMuxPadClass * klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+  GstAggregatorPadClass *aggpad_class = (GstAggregatorPadClass *) klass;
+
+  gobject_class->finalize = gst_dtmf_pin_mux_pad_finalize;
+  aggpad_class->flush = GST_DEBUG_FUNCPTR (gst_dtmf_pin_mux_pad_flush);
+}
+
+/* Pad initialization */
+static void
+gst_dtmf_pin_mux_pad_init (GstDtmfPinMuxPad * pad)
+{
+  gst_audio_info_init (&pad->info);
+  pad->g711 = NULL;
+  pad->decimator = NULL;
+  pad->analysis = NULL;
+  pad->analysis_size = 0;
+  pad->analysis_offset = 0;
+  pad->detector = NULL;
+  pad->pending = NULL;
+  pad->pending_start = GST_CLOCK_TIME_NONE;
+  pad->running_time = GST_CLOCK_TIME_NONE;
+
+  dtmf_pin_entry_reset (&pad->entry);
+  pad->last_digit_time = GST_CLOCK_TIME_NONE;
+  pad->entry_start_time = GST_CLOCK_TIME_NONE;
+}
+
+static void
+gst_dtmf_pin_mux_pad_finalize (GObject * object)
+{
+  GstDtmfPinMuxPad *pad = GST_DTMF_PIN_MUX_PAD (object);
+
+  dtmf_detector_free (pad->detector);
+  dtmf_decimator_free (pad->decimator);
+  g_free (pad->analysis);
+  gst_buffer_replace (&pad->pending, NULL);
+
+  G_OBJECT_CLASS (gst_dtmf_pin_mux_pad_parent_class)->finalize (object);
+}
+
+/* Reset detection and PIN entry state of one input */
+static void
+gst_dtmf_pin_mux_pad_state_reset (GstDtmfPinMuxPad * pad)
+{
+  reset_pin_entry (pad);
+  if (pad->detector)
+    dtmf_detector_reset (pad->detector);
+  if (pad->decimator)
+    dtmf_decimator_reset (pad->decimator);
+  pad->analysis_offset = 0;
+}
+
+static GstFlowReturn
+gst_dtmf_pin_mux_pad_flush (GstAggregatorPad * aggpad, GstAggregator * agg)
+{
+  GstDtmfPinMuxPad *pad = GST_DTMF_PIN_MUX_PAD (aggpad);
+
+  gst_dtmf_pin_mux_pad_state_reset (pad);
+  pad->running_time = GST_CLOCK_TIME_NONE;
+  return GST_FLOW_OK;
+}
+
+/* Element class initialization */
+static void
+gst_dtmf_pin_mux_class_init (GstDtmfPinMuxClass * klass)
+{
+  GObjectClass *gobject_class;
+  GstElementClass *gstelement_class;
+  GstAggregatorClass *gstaggregator_class;
+
+  gobject_class = (GObjectClass *) klass;
+  gstelement_class = (GstElementClass *) klass;
+  gstaggregator_class = (GstAggregatorClass *) klass;
+
+  GST_DEBUG_CATEGORY_INIT (dtmf_pin_mux_debug, "dtmfpinmux", 0,
+      "Multi-input DTMF PIN detection");
+
+  gobject_class->finalize = gst_dtmf_pin_mux_finalize;
+  gobject_class->set_property = gst_dtmf_pin_mux_set_property;
+  gobject_class->get_property = gst_dtmf_pin_mux_get_property;
+
+  gstaggregator_class->start = GST_DEBUG_FUNCPTR (gst_dtmf_pin_mux_start);
+  gstaggregator_class->stop = GST_DEBUG_FUNCPTR (gst_dtmf_pin_mux_stop);
+  gstaggregator_class->sink_event =
+      GST_DEBUG_FUNCPTR (gst_dtmf_pin_mux_sink_event);
+  gstaggregator_class->aggregate =
+      GST_DEBUG_FUNCPTR (gst_dtmf_pin_mux_aggregate);
+  gstaggregator_class->get_next_time = gst_aggregator_simple_get_next_time;
+
+  /* Install properties */
+  g_object_class_install_property (gobject_class, PROP_CONFIG_FILE,
+      g_param_spec_string ("config-file", "Config File",
+          "Path to the PIN configuration file (.pin or compiled .pinx)",
+          "codes.pin",
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_INTER_DIGIT_TIMEOUT,
+      g_param_spec_uint ("inter-digit-timeout", "Inter-Digit Timeout",
+          "Timeout between DTMF digits in milliseconds", 1000, 60000, 3000,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_ENTRY_TIMEOUT,
+      g_param_spec_uint ("entry-timeout", "Entry Timeout",
+          "Timeout for complete PIN entry in milliseconds", 1000, 60000, 10000,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_DETECTOR,
+      g_param_spec_enum ("detector", "Detector",
+          "DTMF detection engine. The goertzel engines need tones 16 dB "
+          "louder than spandsp", GST_TYPE_DTMF_PIN_SRC_DETECTOR,
+          DEFAULT_DETECTOR, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_WORKER_THREADS,
+      g_param_spec_uint ("worker-threads", "Worker Threads",
+          "Threads running detection, 1 runs it on the aggregator thread. "
+          "Applied when the element starts", 1, 64, DEFAULT_WORKER_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_AUTO_RELOAD,
+      g_param_spec_boolean ("auto-reload", "Auto Reload",
+          "Reload the PIN configuration file when it changes on disk", FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_POST_DIGITS,
+      g_param_spec_boolean ("post-digits", "Post Digits",
+          "Post a digit-detected message for every DTMF digit", FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_ENERGY_GATE,
+      g_param_spec_boolean ("energy-gate", "Energy Gate",
+          "Skip the detector on blocks that are too quiet, or whose energy "
+          "lies too far outside the DTMF band, to hold a tone pair", FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /* Add pad templates */
+  gst_element_class_add_static_pad_template_with_gtype (gstelement_class,
+      &sinktemplate, GST_TYPE_DTMF_PIN_MUX_PAD);
+  gst_element_class_add_static_pad_template_with_gtype (gstelement_class,
+      &srctemplate, GST_TYPE_AGGREGATOR_PAD);
+
+  /* Set element details */
+  gst_element_class_set_static_metadata (gstelement_class,
+      "DTMF PIN Detection Mux", "Filter/Analyzer/Audio",
+      "Detects DTMF PIN codes on any number of inputs sharing one PIN list. Emits function name and pad name if pin is valid via bus messages",
+      "DTMF PIN Detection Plugin <http://github.com/TVforME/gstreamer/gstdtmfpinsrc>");
+
+  dtmf_message_init ();
+
+  gst_type_mark_as_plugin_api (GST_TYPE_DTMF_PIN_MUX_PAD, 0);
+}
+
+/* Element initialization */
+static void
+gst_dtmf_pin_mux_init (GstDtmfPinMux * self)
+{
+  self->config_file = g_strdup ("codes.pin");
+  self->pending_pins = NULL;
+  self->auto_reload = FALSE;
+  self->monitor = NULL;
+  self->inter_digit_timeout = 3000;    /* 3 seconds */
+  self->entry_timeout = 10000;         /* 10 seconds */
+  self->detector_engine = DEFAULT_DETECTOR;
+  self->energy_gate = FALSE;
+  self->worker_threads = DEFAULT_WORKER_THREADS;
+  self->post_digits = FALSE;
+
+  self->pool = NULL;
+  g_mutex_init (&self->work_lock);
+  g_cond_init (&self->work_cond);
+  self->work_pending = 0;
+
+  self->cycle_pads = g_ptr_array_new_with_free_func (gst_object_unref);
+  self->next_time = GST_CLOCK_TIME_NONE;
+
+  /* Load default PIN configuration */
+  self->pins = dtmf_pin_table_open (GST_OBJECT (self), self->config_file);
+  if (!self->pins)
+    self->pins = dtmf_pin_table_new ();
+}
+
+/* Finalize */
+static void
+gst_dtmf_pin_mux_finalize (GObject * object)
+{
+  GstDtmfPinMux *self = GST_DTMF_PIN_MUX (object);
+
+  stop_file_monitor (self);
+  dtmf_pin_table_unref (self->pins);
+  dtmf_pin_table_unref (self->pending_pins);
+  g_free (self->config_file);
+  g_ptr_array_unref (self->cycle_pads);
+  g_mutex_clear (&self->work_lock);
+  g_cond_clear (&self->work_cond);
+
+  G_OBJECT_CLASS (gst_dtmf_pin_mux_parent_class)->finalize (object);
+}
+
+/* Copy of the config file path, under the object lock as the property
+ * can be set while the file monitor reads it */
+static gchar *
+dup_config_file (GstDtmfPinMux * self)
+{
+  gchar *filename;
+
+  GST_OBJECT_LOCK (self);
+  filename = g_strdup (self->config_file);
+  GST_OBJECT_UNLOCK (self);
+
+  return filename;
+}
+
+/* Load a new PIN table and publish it; pads pick it up on the next cycle */
+static void
+update_pin_config (GstDtmfPinMux * self, const gchar * filename)
+{
+  DtmfPinTable *pins;
+
+  pins = dtmf_pin_table_open (GST_OBJECT (self), filename);
+  if (!pins)
+    return;
+
+  dtmf_pin_table_publish (&self->pending_pins, pins);
+}
+
+/* Config file changed on disk, see dtmfpinsrc */
+static void
+config_file_changed (GFileMonitor * monitor, GFile * file, GFile * other,
+    GFileMonitorEvent event, GstDtmfPinMux * self)
+{
+  gchar *filename;
+
+  if (event != G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT
+      && event != G_FILE_MONITOR_EVENT_CREATED)
+    return;
+
+  filename = dup_config_file (self);
+  GST_INFO_OBJECT (self, "Reloading changed PIN config file %s", filename);
+  update_pin_config (self, filename);
+  g_free (filename);
+}
+
+/* Stop watching the config file */
+static void
+stop_file_monitor (GstDtmfPinMux * self)
+{
+  if (self->monitor) {
+    g_signal_handlers_disconnect_by_data (self->monitor, self);
+    g_file_monitor_cancel (self->monitor);
+    g_clear_object (&self->monitor);
+  }
+}
+
+/* Watch the config file if auto-reload is enabled */
+static void
+update_file_monitor (GstDtmfPinMux * self)
+{
+  GError *error = NULL;
+  gchar *filename;
+  GFile *file;
+
+  stop_file_monitor (self);
+  filename = dup_config_file (self);
+  if (!self->auto_reload || !filename) {
+    g_free (filename);
+    return;
+  }
+
+  file = g_file_new_for_path (filename);
+  self->monitor = g_file_monitor_file (file, G_FILE_MONITOR_NONE, NULL,
+      &error);
+  g_object_unref (file);
+
+  if (!self->monitor) {
+    GST_WARNING_OBJECT (self, "Cannot watch %s: %s", filename, error->message);
+    g_clear_error (&error);
+    g_free (filename);
+    return;
+  }
+
+  g_signal_connect (self->monitor, "changed",
+      G_CALLBACK (config_file_changed), self);
+  g_free (filename);
+}
+
+/* Property setter */
+static void
+gst_dtmf_pin_mux_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstDtmfPinMux *self = GST_DTMF_PIN_MUX (object);
+
+  switch (prop_id) {
+    case PROP_CONFIG_FILE:{
+      gchar *filename = g_value_dup_string (value);
+
+      GST_OBJECT_LOCK (self);
+      g_free (self->config_file);
+      self->config_file = g_strdup (filename);
+      GST_OBJECT_UNLOCK (self);
+
+      update_pin_config (self, filename);
+      update_file_monitor (self);
+      g_free (filename);
+      break;
+    }
+    case PROP_INTER_DIGIT_TIMEOUT:
+      self->inter_digit_timeout = g_value_get_uint (value);
+      break;
+    case PROP_ENTRY_TIMEOUT:
+      self->entry_timeout = g_value_get_uint (value);
+      break;
+    case PROP_DETECTOR:
+      /* Picked up by each pad on its next buffer */
+      g_atomic_int_set (&self->detector_engine, g_value_get_enum (value));
+      break;
+    case PROP_ENERGY_GATE:
+      /* Picked up by each pad on its next buffer */
+      g_atomic_int_set (&self->energy_gate, g_value_get_boolean (value));
+      break;
+    case PROP_WORKER_THREADS:
+      self->worker_threads = g_value_get_uint (value);
+      break;
+    case PROP_AUTO_RELOAD:
+      self->auto_reload = g_value_get_boolean (value);
+      update_file_monitor (self);
+      break;
+    case PROP_POST_DIGITS:
+      self->post_digits = g_value_get_boolean (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+/* Property getter */
+static void
+gst_dtmf_pin_mux_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstDtmfPinMux *self = GST_DTMF_PIN_MUX (object);
+
+  switch (prop_id) {
+    case PROP_CONFIG_FILE:
+      GST_OBJECT_LOCK (self);
+      g_value_set_string (value, self->config_file);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_INTER_DIGIT_TIMEOUT:
+      g_value_set_uint (value, self->inter_digit_timeout);
+      break;
+    case PROP_ENTRY_TIMEOUT:
+      g_value_set_uint (value, self->entry_timeout);
+      break;
+    case PROP_DETECTOR:
+      g_value_set_enum (value, g_atomic_int_get (&self->detector_engine));
+      break;
+    case PROP_ENERGY_GATE:
+      g_value_set_boolean (value, g_atomic_int_get (&self->energy_gate));
+      break;
+    case PROP_WORKER_THREADS:
+      g_value_set_uint (value, self->worker_threads);
+      break;
+    case PROP_AUTO_RELOAD:
+      g_value_set_boolean (value, self->auto_reload);
+      break;
+    case PROP_POST_DIGITS:
+      g_value_set_boolean (value, self->post_digits);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+/* Worker pool entry point, runs one pad for the current cycle */
+static void
+worker_func (gpointer data, gpointer user_data)
+{
+  GstDtmfPinMux *self = GST_DTMF_PIN_MUX (user_data);
+
+  process_pad (self, GST_DTMF_PIN_MUX_PAD (data));
+
+  g_mutex_lock (&self->work_lock);
+  if (--self->work_pending == 0)
+    g_cond_signal (&self->work_cond);
+  g_mutex_unlock (&self->work_lock);
+}
+
+static gboolean
+gst_dtmf_pin_mux_start (GstAggregator * agg)
+{
+  GstDtmfPinMux *self = GST_DTMF_PIN_MUX (agg);
+  GError *error = NULL;
+
+  self->next_time = GST_CLOCK_TIME_NONE;
+
+  if (self->worker_threads > 1) {
+    self->pool = g_thread_pool_new (worker_func, self, self->worker_threads,
+        TRUE, &error);
+    if (!self->pool) {
+      GST_WARNING_OBJECT (self, "Could not start worker threads: %s",
+          error->message);
+      g_clear_error (&error);
+    } else {
+      GST_DEBUG_OBJECT (self, "Started %u worker threads",
+          self->worker_threads);
+    }
+  }
+
+  return TRUE;
+}
+
+static gboolean
+gst_dtmf_pin_mux_stop (GstAggregator * agg)
+{
+  GstDtmfPinMux *self = GST_DTMF_PIN_MUX (agg);
+
+  if (self->pool) {
+    g_thread_pool_free (self->pool, FALSE, TRUE);
+    self->pool = NULL;
+  }
+
+  return TRUE;
+}
+
+/* Configure the analysis front end of a pad from its caps */
+static gboolean
+set_pad_caps (GstDtmfPinMux * self, GstDtmfPinMuxPad * pad, GstCaps * caps)
+{
+  GstAudioInfo info;
+  DtmfG711Law law;
+
+  if (!dtmf_g711_info_from_caps (caps, &info, &law)) {
+    GST_ERROR_OBJECT (pad, "Invalid input caps %" GST_PTR_FORMAT, caps);
+    return FALSE;
+  }
+
+  GST_DEBUG_OBJECT (pad, "Input sample rate: %d Hz, channels: %d",
+      GST_AUDIO_INFO_RATE (&info), GST_AUDIO_INFO_CHANNELS (&info));
+
+  /* Rebuild the analysis front end when the input rate changes */
+  if (GST_AUDIO_INFO_RATE (&info) != GST_AUDIO_INFO_RATE (&pad->info)) {
+    dtmf_decimator_free (pad->decimator);
+    pad->decimator = NULL;
+
+    if (GST_AUDIO_INFO_RATE (&info) != DTMF_ANALYSIS_RATE)
+      pad->decimator = dtmf_decimator_new (GST_AUDIO_INFO_RATE (&info));
+  }
+  pad->info = info;
+  pad->g711 = dtmf_g711_table (law);
+
+  if (!pad->detector) {
+    pad->detector =
+        dtmf_detector_new (g_atomic_int_get (&self->detector_engine));
+    if (!pad->detector) {
+      GST_ERROR_OBJECT (pad, "Failed to initialize DTMF detector");
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/* Sink event handler, serialized events arrive on the aggregator thread */
+static gboolean
+gst_dtmf_pin_mux_sink_event (GstAggregator * agg, GstAggregatorPad * aggpad,
+    GstEvent * event)
+{
+  GstDtmfPinMux *self = GST_DTMF_PIN_MUX (agg);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_CAPS) {
+    GstCaps *caps;
+
+    gst_event_parse_caps (event, &caps);
+    if (!set_pad_caps (self, GST_DTMF_PIN_MUX_PAD (aggpad), caps)) {
+      gst_event_unref (event);
+      return FALSE;
+    }
+  } else if (GST_EVENT_TYPE (event) == GST_EVENT_EOS) {
+    flush_detector (self, GST_DTMF_PIN_MUX_PAD (aggpad));
+    expire_entry (self, GST_DTMF_PIN_MUX_PAD (aggpad));
+  }
+
+  return GST_AGGREGATOR_CLASS (gst_dtmf_pin_mux_parent_class)->sink_event
+      (agg, aggpad, event);
+}
+
+/* Switch detection engine if the detector property changed, and follow
+ * the energy-gate property */
+static void
+update_detector (GstDtmfPinMux * self, GstDtmfPinMuxPad * pad)
+{
+  DtmfDetectorEngine engine = g_atomic_int_get (&self->detector_engine);
+  DtmfDetector *detector;
+
+  if (!pad->detector || dtmf_detector_get_engine (pad->detector) != engine) {
+    detector = dtmf_detector_new (engine);
+    if (detector) {
+      dtmf_detector_free (pad->detector);
+      pad->detector = detector;
+    } else {
+      GST_WARNING_OBJECT (pad,
+          "Failed to create detector, keeping current one");
+    }
+  }
+
+  if (pad->detector)
+    dtmf_detector_set_gate (pad->detector,
+        g_atomic_int_get (&self->energy_gate));
+}
+
+/* Get the 8 kHz mono analysis samples for a mapped input buffer */
+static const gint16 *
+prepare_analysis_samples (GstDtmfPinMuxPad * pad, const GstMapInfo * map,
+    gsize * n_samples)
+{
+  gint channels = MAX (GST_AUDIO_INFO_CHANNELS (&pad->info), 1);
+  gsize n_frames = map->size / MAX (GST_AUDIO_INFO_BPF (&pad->info), 1);
+  GstAudioFormat format = GST_AUDIO_INFO_FORMAT (&pad->info);
+  const gint16 *in = (const gint16 *) map->data;
+  gsize needed;
+  gsize i;
+
+  if (!pad->decimator && channels == 1 && format == GST_AUDIO_FORMAT_S16) {
+    *n_samples = n_frames;
+    return in;
+  }
+
+  needed = pad->decimator ?
+      dtmf_decimator_max_output (pad->decimator, n_frames) : n_frames;
+  if (needed > pad->analysis_size) {
+    g_free (pad->analysis);
+    pad->analysis = g_new (gint16, needed);
+    pad->analysis_size = needed;
+  }
+
+  /* Only the first channel is analysed */
+  if (pad->g711) {
+    dtmf_g711_expand (pad->g711, map->data, n_frames, channels,
+        pad->analysis);
+    *n_samples = n_frames;
+  } else if (pad->decimator) {
+    switch (format) {
+      case GST_AUDIO_FORMAT_S32:
+        *n_samples = dtmf_decimator_process_s32 (pad->decimator,
+            (const gint32 *) map->data, n_frames, channels, pad->analysis);
+        break;
+      case GST_AUDIO_FORMAT_F32:
+        *n_samples = dtmf_decimator_process_f32 (pad->decimator,
+            (const gfloat *) map->data, n_frames, channels, pad->analysis);
+        break;
+      default:
+        *n_samples = dtmf_decimator_process (pad->decimator, in, n_frames,
+            channels, pad->analysis);
+        break;
+    }
+  } else {
+    switch (format) {
+      case GST_AUDIO_FORMAT_S32:
+        dtmf_deinterleave_channel_s32 ((const gint32 *) map->data, n_frames,
+            channels, pad->analysis);
+        break;
+      case GST_AUDIO_FORMAT_F32:
+        dtmf_deinterleave_channel_f32 ((const gfloat *) map->data, n_frames,
+            channels, pad->analysis);
+        break;
+      default:
+        for (i = 0; i < n_frames; i++)
+          pad->analysis[i] = in[i * channels];
+        break;
+    }
+    *n_samples = n_frames;
+  }
+
+  return pad->analysis;
+}
+
+/* Reset PIN entry state */
+static void
+reset_pin_entry (GstDtmfPinMuxPad * pad)
+{
+  dtmf_pin_entry_reset (&pad->entry);
+  pad->last_digit_time = GST_CLOCK_TIME_NONE;
+  pad->entry_start_time = GST_CLOCK_TIME_NONE;
+}
+
+/* Pad name for messages, interned so they can refer to it. Only the thread
+ * processing @pad calls this. */
+static const gchar *
+pad_message_name (GstDtmfPinMuxPad * pad)
+{
+  if (!pad->message_name)
+    pad->message_name = g_intern_string (GST_PAD_NAME (pad));
+  return pad->message_name;
+}
+
+/* Emit bus message for a detected digit */
+static void
+emit_digit_detected_message (GstDtmfPinMux * self, GstDtmfPinMuxPad * pad,
+    gchar digit, GstClockTime time)
+{
+  GstStructure *structure;
+
+  structure = dtmf_message_digit_detected (digit, 0, pad_message_name (pad),
+      time);
+
+  gst_element_post_message (GST_ELEMENT (self),
+      gst_message_new_element (GST_OBJECT (self), structure));
+}
+
+/* Emit bus message for PIN detection, decided at running time @time */
+static void
+emit_pin_detected_message (GstDtmfPinMux * self, GstDtmfPinMuxPad * pad,
+    const gchar * pin, const gchar * function, gboolean valid,
+    GstClockTime time)
+{
+  GstStructure *structure;
+  GstMessage *message;
+
+  structure = dtmf_message_pin_detected (pin, function, valid, 0,
+      pad_message_name (pad), time);
+
+  message = gst_message_new_element (GST_OBJECT (self), structure);
+  gst_element_post_message (GST_ELEMENT (self), message);
+
+  GST_DEBUG_OBJECT (pad, "Emitted pin-detected message: pin=%s function=%s valid=%d",
+      pin, function ? function : "", valid);
+}
+
+/* Process a single DTMF digit entered at running time @time */
+static void
+process_dtmf_digit (GstDtmfPinMux * self, GstDtmfPinMuxPad * pad, gchar digit,
+    GstClockTime time)
+{
+  const gchar *function = NULL;
+
+  if (self->post_digits)
+    emit_digit_detected_message (self, pad, digit, time);
+
+  switch (dtmf_pin_entry_push (&pad->entry, self->pins, digit, &function)) {
+    case DTMF_PIN_MATCH:
+      GST_INFO_OBJECT (pad, "PIN matched: %s -> %s", pad->entry.buffer,
+          function);
+      emit_pin_detected_message (self, pad, pad->entry.buffer, function, TRUE,
+          time);
+      reset_pin_entry (pad);
+      break;
+    case DTMF_PIN_PREFIX:
+      if (pad->entry.position == 1)
+        pad->entry_start_time = time;
+      pad->last_digit_time = time;
+      break;
+    case DTMF_PIN_DEAD_END:
+      GST_INFO_OBJECT (pad, "No PIN starts with %s", pad->entry.buffer);
+      emit_pin_detected_message (self, pad, pad->entry.buffer, NULL, FALSE,
+          time);
+      reset_pin_entry (pad);
+      break;
+  }
+}
+
+/* Swap in a PIN table published since the last cycle, before any worker
+ * runs, and move the partial entries of all pads onto it */
+static void
+adopt_pending_pins (GstDtmfPinMux * self)
+{
+  DtmfPinTable *pins = dtmf_pin_table_take (&self->pending_pins);
+  const gchar *function;
+  guint i;
+
+  if (!pins)
+    return;
+
+  dtmf_pin_table_unref (self->pins);
+  self->pins = pins;
+  GST_DEBUG_OBJECT (self, "Switched to new PIN table (%d PINs)",
+      dtmf_pin_table_size (pins));
+
+  for (i = 0; i < self->cycle_pads->len; i++) {
+    GstDtmfPinMuxPad *pad = g_ptr_array_index (self->cycle_pads, i);
+
+    if (pad->entry.position == 0)
+      continue;
+
+    switch (dtmf_pin_entry_rebase (&pad->entry, pins, &function)) {
+      case DTMF_PIN_MATCH:
+        GST_INFO_OBJECT (pad, "PIN matched after reload: %s -> %s",
+            pad->entry.buffer, function);
+        emit_pin_detected_message (self, pad, pad->entry.buffer, function,
+            TRUE, pad->last_digit_time);
+        reset_pin_entry (pad);
+        break;
+      case DTMF_PIN_PREFIX:
+        break;
+      case DTMF_PIN_DEAD_END:
+        GST_INFO_OBJECT (pad, "No PIN starts with %s after reload",
+            pad->entry.buffer);
+        emit_pin_detected_message (self, pad, pad->entry.buffer, NULL, FALSE,
+            pad->last_digit_time);
+        reset_pin_entry (pad);
+        break;
+    }
+  }
+}
+
+/* Whether @timeout_ms has passed between @since and @now */
+static gboolean
+timed_out (GstClockTime since, GstClockTime now, guint timeout_ms)
+{
+  return GST_CLOCK_TIME_IS_VALID (since) && now >= since
+      && now - since >= timeout_ms * GST_MSECOND;
+}
+
+/* Inter-digit and entry timeouts of one pad at running time @now */
+static void
+check_timeouts (GstDtmfPinMux * self, GstDtmfPinMuxPad * pad,
+    GstClockTime now)
+{
+  if (pad->entry.position == 0)
+    return;
+
+  if (timed_out (pad->last_digit_time, now, self->inter_digit_timeout)) {
+    GST_INFO_OBJECT (pad, "Inter-digit timeout: %" GST_TIME_FORMAT
+        " >= %ums (PIN: '%s')", GST_TIME_ARGS (now - pad->last_digit_time),
+        self->inter_digit_timeout, pad->entry.buffer);
+    emit_pin_detected_message (self, pad, pad->entry.buffer, NULL, FALSE,
+        now);
+    reset_pin_entry (pad);
+  } else if (timed_out (pad->entry_start_time, now, self->entry_timeout)) {
+    GST_INFO_OBJECT (pad, "Entry timeout: %" GST_TIME_FORMAT
+        " >= %ums (PIN: '%s')", GST_TIME_ARGS (now - pad->entry_start_time),
+        self->entry_timeout, pad->entry.buffer);
+    emit_pin_detected_message (self, pad, pad->entry.buffer, NULL, FALSE,
+        now);
+    reset_pin_entry (pad);
+  }
+}
+
+/* Run detection over the buffer popped for this cycle, in ticks as
+ * dtmfpinsrc does: timeouts that expire up to the end of each tick are
+ * handled before the digits found in it, which count as entered at its
+ * end. A gap only moves the timeouts on to its end. */
+static void
+process_pad (GstDtmfPinMux * self, GstDtmfPinMuxPad * pad)
+{
+  GstBuffer *buf = pad->pending;
+  gchar dtmfbuf[DTMF_DETECTOR_MAX_DIGITS] = "";
+  gint dtmf_count;
+  gint i;
+  GstMapInfo map;
+  const gint16 *samples;
+  gsize n_samples;
+  gsize pos, len;
+  GstClockTime now;
+
+  pad->pending = NULL;
+
+  if (GST_BUFFER_IS_DISCONT (buf))
+    gst_dtmf_pin_mux_pad_state_reset (pad);
+
+  if (!GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_GAP))
+    update_detector (self, pad);
+
+  if (GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_GAP) || !pad->detector
+      || !gst_buffer_map (buf, &map, GST_MAP_READ)) {
+    check_timeouts (self, pad, pad->running_time);
+    gst_buffer_unref (buf);
+    return;
+  }
+
+  samples = prepare_analysis_samples (pad, &map, &n_samples);
+  for (pos = 0; pos < n_samples; pos += len) {
+    len = DTMF_PIN_SRC_TICK_SAMPLES -
+        (pad->analysis_offset + pos) % DTMF_PIN_SRC_TICK_SAMPLES;
+    len = MIN (len, n_samples - pos);
+    now = pad->pending_start + gst_util_uint64_scale_int (pos + len,
+        GST_SECOND, DTMF_ANALYSIS_RATE);
+
+    check_timeouts (self, pad, now);
+
+    dtmf_count = dtmf_detector_process (pad->detector, samples + pos, len,
+        dtmfbuf, DTMF_DETECTOR_MAX_DIGITS);
+    if (dtmf_count)
+      GST_DEBUG_OBJECT (pad, "Got %d DTMF events: %s", dtmf_count, dtmfbuf);
+
+    for (i = 0; i < dtmf_count; i++)
+      process_dtmf_digit (self, pad, dtmfbuf[i], now);
+  }
+  pad->analysis_offset += n_samples;
+
+  gst_buffer_unmap (buf, &map);
+  gst_buffer_unref (buf);
+}
+
+/* Take the digits the detector of @pad still holds back when its input
+ * ends, counted as entered at the end */
+static void
+flush_detector (GstDtmfPinMux * self, GstDtmfPinMuxPad * pad)
+{
+  GstClockTime now = GST_CLOCK_TIME_IS_VALID (pad->running_time) ?
+      pad->running_time : 0;
+  gchar dtmfbuf[DTMF_DETECTOR_MAX_DIGITS];
+  gint dtmf_count, i;
+
+  if (!pad->detector)
+    return;
+
+  dtmf_count = dtmf_detector_flush (pad->detector, dtmfbuf,
+      DTMF_DETECTOR_MAX_DIGITS);
+  if (dtmf_count)
+    GST_DEBUG_OBJECT (pad, "Got %d DTMF events at end of stream: %s",
+        dtmf_count, dtmfbuf);
+
+  for (i = 0; i < dtmf_count; i++)
+    process_dtmf_digit (self, pad, dtmfbuf[i], now);
+}
+
+/* Report the entry still in progress when the input of @pad ends, as its
+ * timeout would have; no more digits can complete it */
+static void
+expire_entry (GstDtmfPinMux * self, GstDtmfPinMuxPad * pad)
+{
+  GstClockTime now = GST_CLOCK_TIME_IS_VALID (pad->running_time) ?
+      pad->running_time : 0;
+
+  if (pad->entry.position == 0)
+    return;
+
+  GST_INFO_OBJECT (pad, "End of stream with PIN '%s' pending",
+      pad->entry.buffer);
+  emit_pin_detected_message (self, pad, pad->entry.buffer, NULL, FALSE, now);
+  reset_pin_entry (pad);
+}
+
+/* Duration of an input buffer, from its size if not set */
+static GstClockTime
+buffer_duration (GstDtmfPinMuxPad * pad, GstBuffer * buf)
+{
+  if (GST_BUFFER_DURATION_IS_VALID (buf))
+    return GST_BUFFER_DURATION (buf);
+  if (GST_AUDIO_INFO_BPF (&pad->info) == 0)
+    return GST_CLOCK_TIME_NONE;
+
+  return gst_util_uint64_scale (gst_buffer_get_size (buf) /
+      GST_AUDIO_INFO_BPF (&pad->info), GST_SECOND,
+      GST_AUDIO_INFO_RATE (&pad->info));
+}
+
+/* Push silence flagged as GAP covering [start, end) */
+static GstFlowReturn
+push_gap (GstDtmfPinMux * self, GstClockTime start, GstClockTime end)
+{
+  GstAggregator *agg = GST_AGGREGATOR (self);
+  guint64 n_samples;
+  GstBuffer *outbuf;
+
+  n_samples = gst_util_uint64_scale (end - start, DTMF_ANALYSIS_RATE,
+      GST_SECOND);
+  if (n_samples == 0)
+    return GST_FLOW_OK;
+
+  outbuf = dtmf_silence_buffer_new (n_samples * sizeof (gint16));
+  GST_BUFFER_PTS (outbuf) = start;
+  GST_BUFFER_DURATION (outbuf) = end - start;
+
+  self->next_time = end;
+  GST_AGGREGATOR_PAD (agg->srcpad)->segment.position = end;
+
+  return gst_aggregator_finish_buffer (agg, outbuf);
+}
+
+/* One aggregation cycle: take at most one buffer from every pad and run
+ * detection on all of them */
+static GstFlowReturn
+gst_dtmf_pin_mux_aggregate (GstAggregator * agg, gboolean timeout)
+{
+  GstDtmfPinMux *self = GST_DTMF_PIN_MUX (agg);
+  GstClockTime start = GST_CLOCK_TIME_NONE;
+  GstClockTime end = GST_CLOCK_TIME_NONE;
+  gboolean all_eos = TRUE;
+  guint n_work = 0;
+  GList *l;
+  guint i;
+
+  /* Snapshot the pads so no lock is held while detecting and posting
+   * messages */
+  GST_OBJECT_LOCK (self);
+  for (l = GST_ELEMENT (agg)->sinkpads; l; l = l->next)
+    g_ptr_array_add (self->cycle_pads, gst_object_ref (l->data));
+  GST_OBJECT_UNLOCK (self);
+
+  adopt_pending_pins (self);
+
+  for (i = 0; i < self->cycle_pads->len; i++) {
+    GstDtmfPinMuxPad *pad = g_ptr_array_index (self->cycle_pads, i);
+    GstAggregatorPad *aggpad = GST_AGGREGATOR_PAD (pad);
+    GstClockTime ts, duration;
+
+    pad->pending = gst_aggregator_pad_pop_buffer (aggpad);
+    if (!pad->pending) {
+      if (!gst_aggregator_pad_is_eos (aggpad))
+        all_eos = FALSE;
+      continue;
+    }
+    all_eos = FALSE;
+    n_work++;
+
+    /* Track the running time covered by this cycle */
+    ts = gst_segment_to_running_time (&aggpad->segment, GST_FORMAT_TIME,
+        GST_BUFFER_PTS (pad->pending));
+    duration = buffer_duration (pad, pad->pending);
+    /* Untimestamped buffers follow on from the previous one */
+    if (GST_CLOCK_TIME_IS_VALID (ts))
+      pad->running_time = ts;
+    else if (!GST_CLOCK_TIME_IS_VALID (pad->running_time))
+      pad->running_time = 0;
+    pad->pending_start = pad->running_time;
+    if (GST_CLOCK_TIME_IS_VALID (duration))
+      pad->running_time += duration;
+
+    if (GST_CLOCK_TIME_IS_VALID (ts)) {
+      if (!GST_CLOCK_TIME_IS_VALID (start) || ts < start)
+        start = ts;
+      if (GST_CLOCK_TIME_IS_VALID (duration)
+          && (!GST_CLOCK_TIME_IS_VALID (end) || ts + duration > end))
+        end = ts + duration;
+    }
+  }
+
+  if (self->cycle_pads->len == 0)
+    all_eos = FALSE;
+
+  /* On a live timeout with no data, keep time moving so the stalled inputs
+   * do not hold up the others */
+  if (!all_eos && !GST_CLOCK_TIME_IS_VALID (start) && timeout) {
+    start = GST_CLOCK_TIME_IS_VALID (self->next_time) ? self->next_time : 0;
+    end = start + TIMEOUT_GAP_DURATION;
+  }
+
+  /* Timeouts run on the running time of each input, the same clock its
+   * digits are stamped with, so they need no timer and behave the same
+   * however fast the input arrives. A pad with a buffer has them checked
+   * tick by tick as it is analysed, so a late digit starts a new entry. A
+   * pad that brought no buffer only moves on with the end of a live
+   * timeout cycle. */
+  for (i = 0; i < self->cycle_pads->len; i++) {
+    GstDtmfPinMuxPad *pad = g_ptr_array_index (self->cycle_pads, i);
+
+    if (!pad->pending && timeout && GST_CLOCK_TIME_IS_VALID (end))
+      check_timeouts (self, pad, end);
+  }
+
+  if (self->pool && n_work > 1) {
+    g_mutex_lock (&self->work_lock);
+    self->work_pending = n_work;
+    g_mutex_unlock (&self->work_lock);
+
+    for (i = 0; i < self->cycle_pads->len; i++) {
+      GstDtmfPinMuxPad *pad = g_ptr_array_index (self->cycle_pads, i);
+
+      if (pad->pending)
+        g_thread_pool_push (self->pool, pad, NULL);
+    }
+
+    g_mutex_lock (&self->work_lock);
+    while (self->work_pending > 0)
+      g_cond_wait (&self->work_cond, &self->work_lock);
+    g_mutex_unlock (&self->work_lock);
+  } else {
+    for (i = 0; i < self->cycle_pads->len; i++) {
+      GstDtmfPinMuxPad *pad = g_ptr_array_index (self->cycle_pads, i);
+
+      if (pad->pending)
+        process_pad (self, pad);
+    }
+  }
+
+  g_ptr_array_set_size (self->cycle_pads, 0);
+
+  if (all_eos)
+    return GST_FLOW_EOS;
+  if (!GST_CLOCK_TIME_IS_VALID (start))
+    return GST_FLOW_OK;
+
+  /* Output timestamps never go backwards */
+  if (GST_CLOCK_TIME_IS_VALID (self->next_time) && start < self->next_time)
+    start = self->next_time;
+  if (!GST_CLOCK_TIME_IS_VALID (end) || end <= start)
+    return GST_FLOW_OK;
+
+  return push_gap (self, start, end);
+}
@@ -0,0 +1,137 @@
+/*
+ * GStreamer - DTMF PIN Source Detection Plugin for the Repeater Project
+ *
+ * Copyright 2025 Robert Hensel VK3DG vk3dg@gmail.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef __GST_DTMF_PIN_MUX_H__
+#define __GST_DTMF_PIN_MUX_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstaggregator.h>
+#include <gst/audio/audio.h>
+#include <gio/gio.h>
+
+#include "dtmfdecimator.h"
+#include "dtmfdetector.h"
+#include "dtmfpin.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_DTMF_PIN_MUX \
+  (gst_dtmf_pin_mux_get_type())
+#define GST_DTMF_PIN_MUX(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), \
+  GST_TYPE_DTMF_PIN_MUX,GstDtmfPinMux))
+#define GST_IS_DTMF_PIN_MUX(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_DTMF_PIN_MUX))
+
+#define GST_TYPE_DTMF_PIN_MUX_PAD \
+  (gst_dtmf_pin_mux_pad_get_type())
+#define GST_DTMF_PIN_MUX_PAD(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), \
+  GST_TYPE_DTMF_PIN_MUX_PAD,GstDtmfPinMuxPad))
+
+typedef struct _GstDtmfPinMux GstDtmfPinMux;
+typedef struct _GstDtmfPinMuxClass GstDtmfPinMuxClass;
+typedef struct _GstDtmfPinMuxPad GstDtmfPinMuxPad;
+typedef struct _GstDtmfPinMuxPadClass GstDtmfPinMuxPadClass;
+
+/* One input stream. Only touched by the aggregator thread, or by a single
+ * worker while the aggregator thread waits for it. */
+struct _GstDtmfPinMuxPad
+{
+  GstAggregatorPad parent;
+
+  /* Input format and 8 kHz analysis path */
+  GstAudioInfo info;
+  const gint16 *g711;           /* expansion table of G.711 input, or NULL */
+  DtmfDecimator *decimator;     /* NULL when the input is already 8 kHz */
+  gint16 *analysis;
+  gsize analysis_size;
+  guint64 analysis_offset;      /* 8 kHz samples analysed since the reset */
+
+  /* DTMF detection state */
+  DtmfDetector *detector;
+
+  /* PIN entry state, times are running time */
+  DtmfPinEntry entry;
+  GstClockTime last_digit_time;
+  GstClockTime entry_start_time;
+
+  /* Buffer popped for the current aggregation cycle and the running time
+   * at its start and end */
+  GstBuffer *pending;
+  GstClockTime pending_start;
+  GstClockTime running_time;
+
+  /* Interned pad name referenced by messages */
+  const gchar *message_name;
+};
+
+struct _GstDtmfPinMuxPadClass
+{
+  GstAggregatorPadClass parent_class;
+};
+
+struct _GstDtmfPinMux
+{
+  GstAggregator parent;
+
+  /* PIN configuration shared by all pads. pins belongs to the aggregator
+   * thread, a reloaded table waits in pending_pins for the next cycle.
+   * config_file is under the object lock. */
+  DtmfPinTable *pins;
+  DtmfPinTable *pending_pins;
+  gchar *config_file;
+  gboolean auto_reload;
+  GFileMonitor *monitor;
+
+  /* Settings */
+  guint inter_digit_timeout;
+  guint entry_timeout;
+  gint detector_engine;         /* DtmfDetectorEngine, read by streaming thread */
+  gint energy_gate;             /* gboolean, read by streaming thread */
+  guint worker_threads;
+  gboolean post_digits;         /* post a digit-detected message per digit */
+
+  /* Worker pool, NULL when detection runs on the aggregator thread */
+  GThreadPool *pool;
+  GMutex work_lock;
+  GCond work_cond;
+  gint work_pending;
+
+  /* Per-cycle state of the aggregator thread */
+  GPtrArray *cycle_pads;
+  GstClockTime next_time;
+};
+
+struct _GstDtmfPinMuxClass
+{
+  GstAggregatorClass parent_class;
+};
+
+GType gst_dtmf_pin_mux_get_type (void);
+GType gst_dtmf_pin_mux_pad_get_type (void);
+
+GST_ELEMENT_REGISTER_DECLARE (dtmfpinmux);
+
+G_END_DECLS
+
+#endif /* __GST_DTMF_PIN_MUX_H__ */
@@ -28,17 +28,70 @@
  * and emit messages with the corresponding function names when a valid PIN is entered.
  * It supports inter-digit timeout and entry timeout, with bus message emission.
  *
+ * Input at 8000, 16000, 32000, 44100 or 48000 Hz is accepted directly. Rates
+ * above 8000 Hz are decimated internally for detection while the original
+ * buffer is passed downstream unchanged.
+ *
+ * Samples may be S16, S32 or F32 in native byte order. Each format has
+ * its own conversion loops into the 16-bit analysis path, chosen once per
+ * buffer, so mixers and resamplers working in float need no audioconvert
+ * in front.
+ *
+ * Interleaved input with up to 8 channels is decoded per channel, each with
+ * its own detector and PIN entry state.
+ *
+ * G.711 mu-law and A-law at 8000 Hz are accepted as well, so RTP payloads
+ * need no decoder in front. The companded samples are expanded through a
+ * table as they are analysed and pass downstream unchanged; muted audio
+ * is filled with the silence code of the law rather than zero bytes.
+ *
  * The plugin emits GStreamer bus messages for PIN detection events:
  *
  * * gchar `pin`: The detected PIN code
  * * gchar `function`: The function name associated with the PIN
  * * gboolean `valid`: Whether the PIN was valid
+ * * gint `channel`: Input channel the PIN was entered on
+ *
+ * The same results are emitted as the `pin-detected` and `digit-detected`
+ * signals, synchronously from the streaming thread. `post-messages=false`
+ * leaves the signals as the only path.
+ *
+ * Every recognised digit is also attached to the next buffer leaving the
+ * element as a #GstDtmfDigitMeta, for consumers in the streaming thread.
+ *
+ * Digits sent out of band are taken as well, so an RTP leg does not need
+ * its audio decoded to find them. RFC 4733 telephone-event packets go to
+ * the `rtp_sink` request pad, and GstDTMF `dtmf-event` custom events may
+ * travel with the audio on the sink pad. Both feed channel 0. A key press
+ * reported both in band and out of band within `dedup-window` counts once.
  *
  * Properties:
- * * gchar `config-file`: Path to the PIN configuration file
+ * * gchar `config-file`: Path to the PIN configuration file, either a codes.pin
+ *   text file or a .pinx index written by dtmfpin-compile
+ * * gboolean `auto-reload`: Reload the PIN configuration when the file changes
+ *   on disk (default: FALSE)
  * * guint `inter-digit-timeout`: Timeout between digits in milliseconds (default: 3000)
  * * guint `entry-timeout`: Timeout for complete PIN entry in milliseconds (default: 10000)
- * * gboolean `pass-through`: Allow input audio to pass through to output (default: FALSE)
+ * * GstDtmfPinSrcPassThrough `pass-through`: Pass the input audio through
+ *   unchanged (`true`), with the DTMF tones muted (`suppress`) or not at all
+ *   (default: `false`)
+ * * GstDtmfPinSrcDetector `detector`: DTMF detection engine, `spandsp`, the in-tree
+ *   SIMD `goertzel` filter bank, or `goertzel-batch` which packs the streams of
+ *   all elements into the SIMD lanes of a shared engine (default: spandsp)
+ * * gboolean `energy-gate`: Skip the detector on blocks too quiet, or with
+ *   their energy too far outside the DTMF band, to hold a tone pair
+ *   (default: FALSE). `samples-analysed` and `samples-skipped` tell how
+ *   much of the input the detector was spared.
+ * * guint `dedup-window`: Longest time in milliseconds between the in-band
+ *   and the out-of-band report of one key press, 0 counts both (default: 500)
+ * * gdouble `threshold`, `twist`, `reverse-twist` and gboolean
+ *   `filter-dialtone`: spandsp dtmf_rx level, twist limits in dB and
+ *   350/440 Hz dial tone filter (defaults: -26 dBm0, 8 dB, 4 dB, FALSE)
+ * * guint `min-duration`: Shortest tone in milliseconds that counts as a
+ *   digit, for any engine, 0 for no limit (default: 0)
+ *
+ * The tuning properties may change while playing and reach the detectors
+ * with the next buffer without resetting them.
  *
  */
 
@@ -47,6 +100,12 @@
 #endif
 
 #include "gstdtmfpinsrc.h"
+#include "dtmfsilence.h"
+#include "gstdtmfdigitmeta.h"
+#include "dtmfmessage.h"
+#include "gstdtmfpinmux.h"
+#include "dtmfdeinterleave.h"
+#include "dtmfg711.h"
 
 #include <string.h>
 #include <time.h>
@@ -56,24 +115,42 @@
 GST_DEBUG_CATEGORY (dtmf_pin_src_debug);
 #define GST_CAT_DEFAULT (dtmf_pin_src_debug)
 
-/* Pad templates - input accepts 8000Hz for spandsp compatibility */
+/* Pad templates - input is decimated internally to the 8000Hz spandsp
+ * analysis rate, the full-rate buffer passes through untouched. G.711 is
+ * taken at the 8000Hz it is carried at. */
+#define DTMF_PIN_SRC_CAPS \
+    "audio/x-raw, " \
+    "format = (string) { " GST_AUDIO_NE (S16) ", " GST_AUDIO_NE (S32) ", " \
+    GST_AUDIO_NE (F32) " }, " \
+    "rate = (int) { 8000, 16000, 32000, 44100, 48000 }, " \
+    "channels = (int) [ 1, 8 ], " \
+    "layout = (string) interleaved; " \
+    "audio/x-mulaw, " \
+    "rate = (int) 8000, " \
+    "channels = (int) [ 1, 8 ]; " \
+    "audio/x-alaw, " \
+    "rate = (int) 8000, " \
+    "channels = (int) [ 1, 8 ]"
+
 static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS ("audio/x-raw, "
-        "format = (string) " GST_AUDIO_NE (S16) ", "
-        "rate = (int) 8000, "
-        "channels = (int) { 1, 2 }")
+    GST_STATIC_CAPS (DTMF_PIN_SRC_CAPS)
     );
 
-/* Output pad can handle multiple rates for flexibility */
 static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS ("audio/x-raw, "
-        "format = (string) " GST_AUDIO_NE (S16) ", "
-        "rate = (int) { 8000, 44100, 48000 }, "
-        "channels = (int) { 1, 2 }")
+    GST_STATIC_CAPS (DTMF_PIN_SRC_CAPS)
+    );
+
+/* RFC 4733 events, as they come out of the jitterbuffer */
+static GstStaticPadTemplate rtptemplate = GST_STATIC_PAD_TEMPLATE ("rtp_sink",
+    GST_PAD_SINK,
+    GST_PAD_REQUEST,
+    GST_STATIC_CAPS ("application/x-rtp, "
+        "media = (string) audio, "
+        "encoding-name = (string) TELEPHONE-EVENT")
     );
 
 /* Properties */
@@ -83,9 +160,111 @@ enum
   PROP_CONFIG_FILE,
   PROP_INTER_DIGIT_TIMEOUT,
   PROP_ENTRY_TIMEOUT,
-  PROP_PASS_THROUGH
+  PROP_PASS_THROUGH,
+  PROP_DETECTOR,
+  PROP_AUTO_RELOAD,
+  PROP_POST_DIGITS,
+  PROP_TIMER_RESOLUTION,
+  PROP_SILENCE_MODE,
+  PROP_SUPPRESS_DELAY,
+  PROP_POST_MESSAGES,
+  PROP_EVENT_RING_SIZE,
+  PROP_EVENTS_DROPPED,
+  PROP_MESSAGES_POSTED,
+  PROP_ENERGY_GATE,
+  PROP_SAMPLES_ANALYSED,
+  PROP_SAMPLES_SKIPPED,
+  PROP_DEDUP_WINDOW,
+  PROP_THRESHOLD,
+  PROP_TWIST,
+  PROP_REVERSE_TWIST,
+  PROP_FILTER_DIALTONE,
+  PROP_MIN_DURATION
+};
+
+/* Signals */
+enum
+{
+  SIGNAL_DIGIT_DETECTED,
+  SIGNAL_PIN_DETECTED,
+  LAST_SIGNAL
 };
 
+static guint gst_dtmf_pin_src_signals[LAST_SIGNAL] = { 0 };
+
+#define DEFAULT_DETECTOR DTMF_DETECTOR_ENGINE_SPANDSP
+#define DEFAULT_SILENCE_MODE GST_DTMF_PIN_SRC_SILENCE_GAP
+#define DEFAULT_SUPPRESS_DELAY DTMF_PIN_SRC_MAX_SUPPRESS_DELAY
+#define DEFAULT_DEDUP_WINDOW 500
+
+/* Channels with PIN entry state. Channel 0 takes out-of-band digits
+ * before the audio has caps. */
+#define ENTRY_CHANNELS(self) MAX ((self)->n_channels, 1)
+
+/* Time a stream may deliver late before it counts as stalled, in us */
+#define STALL_GRACE (500 * G_TIME_SPAN_MILLISECOND)
+
+GType
+gst_dtmf_pin_src_detector_get_type (void)
+{
+  static GType detector_type = 0;
+  static const GEnumValue detectors[] = {
+    {DTMF_DETECTOR_ENGINE_SPANDSP, "spandsp dtmf_rx", "spandsp"},
+    {DTMF_DETECTOR_ENGINE_GOERTZEL, "In-tree SIMD Goertzel filter bank",
+        "goertzel"},
+    {DTMF_DETECTOR_ENGINE_BATCH,
+        "Goertzel filter bank shared by all streams, one stream per SIMD lane",
+        "goertzel-batch"},
+    {0, NULL, NULL}
+  };
+
+  if (g_once_init_enter (&detector_type)) {
+    GType _type = g_enum_register_static ("GstDtmfPinSrcDetector", detectors);
+    g_once_init_leave (&detector_type, _type);
+  }
+  return detector_type;
+}
+
+GType
+gst_dtmf_pin_src_pass_through_get_type (void)
+{
+  static GType pass_through_type = 0;
+  static const GEnumValue modes[] = {
+    {GST_DTMF_PIN_SRC_PASS_THROUGH_FALSE, "Output silence", "false"},
+    {GST_DTMF_PIN_SRC_PASS_THROUGH_TRUE, "Pass the input audio unchanged",
+        "true"},
+    {GST_DTMF_PIN_SRC_PASS_THROUGH_SUPPRESS,
+        "Pass the input audio with the DTMF tones muted", "suppress"},
+    {0, NULL, NULL}
+  };
+
+  if (g_once_init_enter (&pass_through_type)) {
+    GType _type = g_enum_register_static ("GstDtmfPinSrcPassThrough", modes);
+    g_once_init_leave (&pass_through_type, _type);
+  }
+  return pass_through_type;
+}
+
+GType
+gst_dtmf_pin_src_silence_mode_get_type (void)
+{
+  static GType silence_mode_type = 0;
+  static const GEnumValue modes[] = {
+    {GST_DTMF_PIN_SRC_SILENCE_ZERO, "Zero the input buffer in place", "zero"},
+    {GST_DTMF_PIN_SRC_SILENCE_GAP,
+        "GAP buffers backed by shared read-only silence", "gap"},
+    {GST_DTMF_PIN_SRC_SILENCE_DROP, "Drop buffers and send GAP events",
+        "drop"},
+    {0, NULL, NULL}
+  };
+
+  if (g_once_init_enter (&silence_mode_type)) {
+    GType _type = g_enum_register_static ("GstDtmfPinSrcSilenceMode", modes);
+    g_once_init_leave (&silence_mode_type, _type);
+  }
+  return silence_mode_type;
+}
+
 static void gst_dtmf_pin_src_finalize (GObject * object);
 static void gst_dtmf_pin_src_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
@@ -94,22 +273,47 @@ static void gst_dtmf_pin_src_get_property (GObject * object, guint prop_id,
 
 static gboolean gst_dtmf_pin_src_set_caps (GstBaseTransform * trans,
     GstCaps * incaps, GstCaps * outcaps);
+static GstFlowReturn gst_dtmf_pin_src_generate_output (GstBaseTransform *
+    trans, GstBuffer ** outbuf);
 static GstFlowReturn gst_dtmf_pin_src_transform_ip (GstBaseTransform * trans,
     GstBuffer * buf);
 static gboolean gst_dtmf_pin_src_sink_event (GstBaseTransform * trans,
     GstEvent * event);
-
-static gboolean load_pin_config (GstDtmfPinSrc * self, const gchar * filename);
-static void reset_pin_entry (GstDtmfPinSrc * self);
-static gboolean check_pin_match (GstDtmfPinSrc * self);
-static void emit_pin_detected_message (GstDtmfPinSrc * self, const gchar * pin,
-    const gchar * function, gboolean valid);
-
-static gboolean check_timeouts_continuously (GstDtmfPinSrc * self);
-static void start_timeout_checking (GstDtmfPinSrc * self);
-static void stop_timeout_checking (GstDtmfPinSrc * self);
+static gboolean gst_dtmf_pin_src_query (GstBaseTransform * trans,
+    GstPadDirection direction, GstQuery * query);
+static gboolean gst_dtmf_pin_src_stop (GstBaseTransform * trans);
+static GstPad *gst_dtmf_pin_src_request_new_pad (GstElement * element,
+    GstPadTemplate * templ, const gchar * name, const GstCaps * caps);
+static void gst_dtmf_pin_src_release_pad (GstElement * element, GstPad * pad);
+
+static void reset_pin_entry (GstDtmfPinSrcChannel * ch);
+static GArray *new_report_queue (void);
+static GArray *take_reports (GstDtmfPinSrc * self);
+static void emit_reports (GstDtmfPinSrc * self, GArray * reports);
+static void emit_digit_detected_message (GstDtmfPinSrc * self, gint channel,
+    gchar digit, GstClockTime time);
+static void emit_pin_detected_message (GstDtmfPinSrc * self, gint channel,
+    const gchar * pin, const gchar * function, gboolean valid,
+    GstClockTime time);
+static void report_pin (GstDtmfPinSrc * self, gint channel, const gchar * pin,
+    const gchar * function, gboolean valid, GstClockTime time);
+
+static void check_channel_timeouts (GstDtmfPinSrc * self, gint channel,
+    GstClockTime now);
+static void check_timeouts (GstDtmfPinSrc * self, GstClockTime now);
+static void flush_detectors (GstDtmfPinSrc * self);
+static void expire_entries (GstDtmfPinSrc * self);
+static void update_stall_timer (GstDtmfPinSrc * self);
+static void tune_detector (GstDtmfPinSrc * self, GstDtmfPinSrcChannel * ch);
+static void stall_timer_expired (gpointer data);
+static void stop_file_monitor (GstDtmfPinSrc * self);
 static void gst_dtmf_pin_src_state_reset (GstDtmfPinSrc * self);
-static void process_dtmf_digit (GstDtmfPinSrc * self, gchar digit);
+static void process_dtmf_digit (GstDtmfPinSrc * self, gint channel,
+    gchar digit, GstClockTime time);
+static gboolean duplicate_digit (GstDtmfPinSrc * self, gint channel,
+    gchar digit, GstClockTime time, gboolean out_of_band);
+static void process_out_of_band_digit (GstDtmfPinSrc * self, gchar digit,
+    GstClockTime time);
 
 G_DEFINE_TYPE (GstDtmfPinSrc, gst_dtmf_pin_src, GST_TYPE_BASE_TRANSFORM);
 
@@ -132,13 +336,23 @@ gst_dtmf_pin_src_class_init (GstDtmfPinSrcClass * klass)
   gstbasetransform_class->set_caps = GST_DEBUG_FUNCPTR (gst_dtmf_pin_src_set_caps);
   gstbasetransform_class->transform_ip =
       GST_DEBUG_FUNCPTR (gst_dtmf_pin_src_transform_ip);
+  gstbasetransform_class->generate_output =
+      GST_DEBUG_FUNCPTR (gst_dtmf_pin_src_generate_output);
   gstbasetransform_class->sink_event =
       GST_DEBUG_FUNCPTR (gst_dtmf_pin_src_sink_event);
+  gstbasetransform_class->query = GST_DEBUG_FUNCPTR (gst_dtmf_pin_src_query);
+  gstbasetransform_class->stop = GST_DEBUG_FUNCPTR (gst_dtmf_pin_src_stop);
+
+  gstelement_class->request_new_pad =
+      GST_DEBUG_FUNCPTR (gst_dtmf_pin_src_request_new_pad);
+  gstelement_class->release_pad =
+      GST_DEBUG_FUNCPTR (gst_dtmf_pin_src_release_pad);
 
   /* Install properties */
   g_object_class_install_property (gobject_class, PROP_CONFIG_FILE,
       g_param_spec_string ("config-file", "Config File",
-          "Path to the PIN configuration file", "codes.pin",
+          "Path to the PIN configuration file (.pin or compiled .pinx)",
+          "codes.pin",
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   g_object_class_install_property (gobject_class, PROP_INTER_DIGIT_TIMEOUT,
@@ -152,15 +366,180 @@ gst_dtmf_pin_src_class_init (GstDtmfPinSrcClass * klass)
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   g_object_class_install_property (gobject_class, PROP_PASS_THROUGH,
-      g_param_spec_boolean ("pass-through", "Pass Through",
-          "Allow input audio to pass through to output", FALSE,
+      g_param_spec_enum ("pass-through", "Pass Through",
+          "Allow input audio to pass through to output, optionally with the "
+          "DTMF tones muted", GST_TYPE_DTMF_PIN_SRC_PASS_THROUGH,
+          GST_DTMF_PIN_SRC_PASS_THROUGH_FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_SUPPRESS_DELAY,
+      g_param_spec_uint ("suppress-delay", "Suppress Delay",
+          "Lookahead in milliseconds with pass-through=suppress, muting the "
+          "start of a tone before it is detected. Adds as much latency", 0,
+          DTMF_PIN_SRC_MAX_SUPPRESS_DELAY, DEFAULT_SUPPRESS_DELAY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_DETECTOR,
+      g_param_spec_enum ("detector", "Detector",
+          "DTMF detection engine. The goertzel engines need tones 16 dB "
+          "louder than spandsp", GST_TYPE_DTMF_PIN_SRC_DETECTOR,
+          DEFAULT_DETECTOR, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_AUTO_RELOAD,
+      g_param_spec_boolean ("auto-reload", "Auto Reload",
+          "Reload the PIN configuration file when it changes on disk", FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_POST_DIGITS,
+      g_param_spec_boolean ("post-digits", "Post Digits",
+          "Post a digit-detected message for every DTMF digit", FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_TIMER_RESOLUTION,
+      g_param_spec_uint ("timer-resolution", "Timer Resolution",
+          "Resolution in milliseconds of the timer wheel that expires entries "
+          "on stalled streams. Shared by all instances in the process",
+          DTMF_TIMER_WHEEL_MIN_RESOLUTION, DTMF_TIMER_WHEEL_MAX_RESOLUTION,
+          DTMF_TIMER_WHEEL_DEFAULT_RESOLUTION,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_SILENCE_MODE,
+      g_param_spec_enum ("silence-mode", "Silence Mode",
+          "How audio is muted when pass-through is disabled",
+          GST_TYPE_DTMF_PIN_SRC_SILENCE_MODE, DEFAULT_SILENCE_MODE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_POST_MESSAGES,
+      g_param_spec_boolean ("post-messages", "Post Messages",
+          "Post pin-detected and digit-detected messages on the bus. The "
+          "signals are emitted either way", TRUE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_EVENT_RING_SIZE,
+      g_param_spec_uint ("event-ring-size", "Event Ring Size",
+          "Events kept for gst_dtmf_pin_src_pop_event(), rounded up to a power "
+          "of two. 0 disables the ring", 0, DTMF_EVENT_RING_MAX_SIZE, 0,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_EVENTS_DROPPED,
+      g_param_spec_uint ("events-dropped", "Events Dropped",
+          "Events lost because the event ring was full", 0, G_MAXUINT, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_MESSAGES_POSTED,
+      g_param_spec_uint ("messages-posted", "Messages Posted",
+          "Number of pin-detected and digit-detected messages posted", 0,
+          G_MAXUINT, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_ENERGY_GATE,
+      g_param_spec_boolean ("energy-gate", "Energy Gate",
+          "Skip the detector on blocks that are too quiet, or whose energy "
+          "lies too far outside the DTMF band, to hold a tone pair", FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_SAMPLES_ANALYSED,
+      g_param_spec_uint64 ("samples-analysed", "Samples Analysed",
+          "8 kHz samples analysed, counting every channel", 0, G_MAXUINT64,
+          0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_SAMPLES_SKIPPED,
+      g_param_spec_uint64 ("samples-skipped", "Samples Skipped",
+          "8 kHz samples the energy gate kept from the detector", 0,
+          G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_DEDUP_WINDOW,
+      g_param_spec_uint ("dedup-window", "Dedup Window",
+          "Longest time in milliseconds between the in-band and the "
+          "out-of-band report of one key press for it to count once. 0 "
+          "counts both", 0, 5000, DEFAULT_DEDUP_WINDOW,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_THRESHOLD,
+      g_param_spec_double ("threshold", "Threshold",
+          "Level in dBm0 each tone of a pair must reach (spandsp detector). "
+          "The energy gate follows it", -60.0, 0.0,
+          DTMF_DETECTOR_DEFAULT_THRESHOLD,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_TWIST,
+      g_param_spec_double ("twist", "Twist",
+          "dB the high tone may lie below the low tone (spandsp detector)",
+          0.0, 20.0, DTMF_DETECTOR_DEFAULT_TWIST,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_REVERSE_TWIST,
+      g_param_spec_double ("reverse-twist", "Reverse Twist",
+          "dB the low tone may lie below the high tone (spandsp detector)",
+          0.0, 20.0, DTMF_DETECTOR_DEFAULT_REVERSE_TWIST,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_FILTER_DIALTONE,
+      g_param_spec_boolean ("filter-dialtone", "Filter Dialtone",
+          "Notch out 350 and 440 Hz dial tone before detection (spandsp "
+          "detector)", FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_MIN_DURATION,
+      g_param_spec_uint ("min-duration", "Minimum Duration",
+          "Shortest tone in milliseconds that counts as a digit, 0 for no "
+          "limit. Longer limits delay each digit until its tone has lasted "
+          "that long", 0, 1000, 0,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstDtmfPinSrc::digit-detected:
+   * @dtmfpinsrc: the element
+   * @channel: input channel the digit was detected on
+   * @digit: the digit
+   * @timestamp: running time at which the digit counts as entered
+   *
+   * Emitted for every digit from the streaming thread, once the buffer it
+   * was found in has been analysed. No element lock is held, so handlers
+   * may set properties, but the stream waits for them to return and they
+   * must not push data into the element.
+   */
+  gst_dtmf_pin_src_signals[SIGNAL_DIGIT_DETECTED] =
+      g_signal_new ("digit-detected", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL, G_TYPE_NONE, 3, G_TYPE_INT,
+      G_TYPE_CHAR, G_TYPE_UINT64);
+
+  /**
+   * GstDtmfPinSrc::pin-detected:
+   * @dtmfpinsrc: the element
+   * @channel: input channel the PIN was entered on
+   * @pin: the digits entered
+   * @function: function of the PIN, empty when it is not valid
+   * @valid: whether the PIN matched
+   * @timestamp: running time at which the result was decided
+   *
+   * Emitted with the same values as the pin-detected message, but
+   * synchronously from the streaming thread, or from the shared timer
+   * thread when an entry on a stalled stream times out. No element lock
+   * is held, so handlers may set properties; a slow handler on the timer
+   * thread delays the timeouts of every element. The strings are only
+   * valid during the emission.
+   */
+  gst_dtmf_pin_src_signals[SIGNAL_PIN_DETECTED] =
+      g_signal_new ("pin-detected", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL, G_TYPE_NONE, 5, G_TYPE_INT,
+      G_TYPE_STRING | G_SIGNAL_TYPE_STATIC_SCOPE,
+      G_TYPE_STRING | G_SIGNAL_TYPE_STATIC_SCOPE, G_TYPE_BOOLEAN,
+      G_TYPE_UINT64);
+
+  dtmf_message_init ();
+
+  gst_type_mark_as_plugin_api (GST_TYPE_DTMF_PIN_SRC_DETECTOR, 0);
+  gst_type_mark_as_plugin_api (GST_TYPE_DTMF_PIN_SRC_PASS_THROUGH, 0);
+  gst_type_mark_as_plugin_api (GST_TYPE_DTMF_PIN_SRC_SILENCE_MODE, 0);
+
   /* Add pad templates */
   gst_element_class_add_pad_template (gstelement_class,
       gst_static_pad_template_get (&sinktemplate));
   gst_element_class_add_pad_template (gstelement_class,
       gst_static_pad_template_get (&srctemplate));
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&rtptemplate));
 
   /* Set element details */
   gst_element_class_set_static_metadata (gstelement_class,
@@ -173,43 +552,88 @@ gst_dtmf_pin_src_class_init (GstDtmfPinSrcClass * klass)
 static void
 gst_dtmf_pin_src_init (GstDtmfPinSrc * self)
 {
+  gint c;
+
   gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (self), TRUE);
   gst_base_transform_set_gap_aware (GST_BASE_TRANSFORM (self), TRUE);
 
   /* Initialize DTMF state */
-  self->dtmf_state = NULL;
+  for (c = 0; c < DTMF_PIN_SRC_MAX_CHANNELS; c++) {
+    GstDtmfPinSrcChannel *ch = &self->channels[c];
+
+    ch->detector = NULL;
+    ch->decimator = NULL;
+    ch->params_cookie = 0;
+    dtmf_pin_entry_reset (&ch->entry);
+    ch->last_digit_time = GST_CLOCK_TIME_NONE;
+    ch->entry_start_time = GST_CLOCK_TIME_NONE;
+    ch->dedup_digit = 0;
+    ch->dedup_out_of_band = FALSE;
+    ch->dedup_time = GST_CLOCK_TIME_NONE;
+  }
+  self->n_channels = 0;
+  self->detector_engine = DEFAULT_DETECTOR;
+  self->energy_gate = FALSE;
+  dtmf_detector_params_init (&self->detector_params);
+  self->params_cookie = 0;
+  self->samples_analysed = 0;
+  self->samples_skipped = 0;
+  gst_audio_info_init (&self->info);
+  self->planar = NULL;
+  self->planar_size = 0;
+  self->analysis = NULL;
+  self->g711 = NULL;
+  self->silence = 0;
+  self->analysis_size = 0;
+  self->analysis_offset = 0;
 
   /* Initialize PIN configuration */
-  self->pin_count = 0;
+  self->pins = NULL;
+  self->pending_pins = NULL;
   self->config_file = g_strdup ("codes.pin");
-
-  /* Initialize PIN entry state */
-  memset (self->pin_buffer, 0, sizeof (self->pin_buffer));
-  self->pin_position = 0;
-
-  /* Initialize timers */
-  self->inter_digit_timer = g_timer_new ();
-  self->entry_timer = g_timer_new ();
-  self->last_digit_timer = g_timer_new ();
-  self->last_digit_interval = 0.0;
+  self->auto_reload = FALSE;
+  self->monitor = NULL;
 
   /* Set default timeouts */
   self->inter_digit_timeout = 3000;    /* 3 seconds */
   self->entry_timeout = 10000;         /* 10 seconds */
-  self->timeout_check_id = 0;
+  self->running_time = GST_CLOCK_TIME_NONE;
 
   /* Initialize pass-through (disabled by default) */
-  self->pass_through = FALSE;
-
-  /* Start continuous timeout checking */
-  start_timeout_checking (self);
+  self->pass_through = GST_DTMF_PIN_SRC_PASS_THROUGH_FALSE;
+  self->silence_mode = DEFAULT_SILENCE_MODE;
+  self->suppress_delay = DEFAULT_SUPPRESS_DELAY;
+  self->delay_line = NULL;
+  self->delay_scratch = NULL;
+  self->delay_frames = 0;
+  self->delay_fill = 0;
+  self->delay_end = GST_CLOCK_TIME_NONE;
+  self->post_digits = FALSE;
+  self->post_messages = TRUE;
+  self->messages_posted = 0;
+  self->events = NULL;
+  self->event_ring_size = 0;
+  self->pending_digits = g_array_new (FALSE, FALSE,
+      sizeof (GstDtmfPinSrcDigit));
+  self->reports = new_report_queue ();
+  self->rtp_sinkpad = NULL;
+  dtmf_rtp_event_state_reset (&self->rtp_state);
+  gst_segment_init (&self->rtp_segment, GST_FORMAT_TIME);
+  self->dedup_window = DEFAULT_DEDUP_WINDOW;
+  self->rtp_eos = FALSE;
+  self->held_eos = NULL;
+
+  /* Backstop for streams that stop with an entry in progress */
+  g_mutex_init (&self->entry_lock);
+  self->stall_ref = g_new0 (GWeakRef, 1);
+  g_weak_ref_init (self->stall_ref, self);
+  self->stall_timer = dtmf_timer_new (stall_timer_expired, self->stall_ref);
+  self->last_data_time = 0;
 
   /* Load default PIN configuration */
-  load_pin_config (self, self->config_file);
-
-  /* Start timers */
-  g_timer_start (self->inter_digit_timer);
-  g_timer_start (self->entry_timer);
+  self->pins = dtmf_pin_table_open (GST_OBJECT (self), self->config_file);
+  if (!self->pins)
+    self->pins = dtmf_pin_table_new ();
 }
 
 /* Finalize */
@@ -217,26 +641,175 @@ static void
 gst_dtmf_pin_src_finalize (GObject * object)
 {
   GstDtmfPinSrc *self = GST_DTMF_PIN_SRC (object);
+  gint c;
+
+  stop_file_monitor (self);
+  /* Waits for a callback running on the wheel thread, unless this is it */
+  dtmf_timer_free (self->stall_timer);
+  g_weak_ref_clear (self->stall_ref);
+  g_free (self->stall_ref);
+  g_mutex_clear (&self->entry_lock);
+
+  for (c = 0; c < DTMF_PIN_SRC_MAX_CHANNELS; c++) {
+    GstDtmfPinSrcChannel *ch = &self->channels[c];
 
-  if (self->dtmf_state)
-    dtmf_rx_free (self->dtmf_state);
+    dtmf_detector_free (ch->detector);
+    dtmf_decimator_free (ch->decimator);
+  }
+  g_free (self->planar);
+  g_free (self->analysis);
+  g_free (self->delay_line);
+  g_free (self->delay_scratch);
+  g_array_free (self->pending_digits, TRUE);
+  g_array_free (self->reports, TRUE);
+  dtmf_event_ring_free (self->events);
+  gst_event_replace (&self->held_eos, NULL);
+  dtmf_pin_table_unref (self->pins);
+  dtmf_pin_table_unref (self->pending_pins);
 
   if (self->config_file)
     g_free (self->config_file);
 
-  if (self->inter_digit_timer)
-    g_timer_destroy (self->inter_digit_timer);
+  G_OBJECT_CLASS (gst_dtmf_pin_src_parent_class)->finalize (object);
+}
+
+/* Copy of the config file path, under the object lock as the property
+ * can be set while the file monitor reads it */
+static gchar *
+dup_config_file (GstDtmfPinSrc * self)
+{
+  gchar *filename;
+
+  GST_OBJECT_LOCK (self);
+  filename = g_strdup (self->config_file);
+  GST_OBJECT_UNLOCK (self);
+
+  return filename;
+}
 
-  if (self->entry_timer)
-    g_timer_destroy (self->entry_timer);
+/* Load a new PIN table and publish it to the streaming thread, which
+ * swaps it in at the start of its next buffer. Loading happens here, so a
+ * large file never holds up the audio. */
+static void
+update_pin_config (GstDtmfPinSrc * self, const gchar * filename)
+{
+  DtmfPinTable *pins;
 
-  if (self->last_digit_timer)
-    g_timer_destroy (self->last_digit_timer);
+  pins = dtmf_pin_table_open (GST_OBJECT (self), filename);
+  if (!pins)
+    return;
 
-  /* Stop timeout checking */
-  stop_timeout_checking (self);
+  dtmf_pin_table_publish (&self->pending_pins, pins);
+}
 
-  G_OBJECT_CLASS (gst_dtmf_pin_src_parent_class)->finalize (object);
+/* Config file changed on disk */
+static void
+config_file_changed (GFileMonitor * monitor, GFile * file, GFile * other,
+    GFileMonitorEvent event, GstDtmfPinSrc * self)
+{
+  gchar *filename;
+
+  /* Editors finish with CHANGES_DONE_HINT, an atomic replace (as done by
+   * dtmfpin-compile) shows up as CREATED */
+  if (event != G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT
+      && event != G_FILE_MONITOR_EVENT_CREATED)
+    return;
+
+  filename = dup_config_file (self);
+  GST_INFO_OBJECT (self, "Reloading changed PIN config file %s", filename);
+  update_pin_config (self, filename);
+  g_free (filename);
+}
+
+/* Stop watching the config file */
+static void
+stop_file_monitor (GstDtmfPinSrc * self)
+{
+  if (self->monitor) {
+    g_signal_handlers_disconnect_by_data (self->monitor, self);
+    g_file_monitor_cancel (self->monitor);
+    g_clear_object (&self->monitor);
+  }
+}
+
+/* Watch the config file if auto-reload is enabled. The monitor reports
+ * changes on the main context of the thread that set the property. */
+static void
+update_file_monitor (GstDtmfPinSrc * self)
+{
+  GError *error = NULL;
+  gchar *filename;
+  GFile *file;
+
+  stop_file_monitor (self);
+  filename = dup_config_file (self);
+  if (!self->auto_reload || !filename) {
+    g_free (filename);
+    return;
+  }
+
+  file = g_file_new_for_path (filename);
+  self->monitor = g_file_monitor_file (file, G_FILE_MONITOR_NONE, NULL,
+      &error);
+  g_object_unref (file);
+
+  if (!self->monitor) {
+    GST_WARNING_OBJECT (self, "Cannot watch %s: %s", filename, error->message);
+    g_clear_error (&error);
+    g_free (filename);
+    return;
+  }
+
+  g_signal_connect (self->monitor, "changed",
+      G_CALLBACK (config_file_changed), self);
+  GST_DEBUG_OBJECT (self, "Watching %s for changes", filename);
+  g_free (filename);
+}
+
+/* Swap in a PIN table published since the last buffer. The partial entry
+ * of each channel moves to the new trie so digits already entered still
+ * count; an entry the new table completes or rules out is reported now.
+ * Nothing else walks the old table, so it can go right away. */
+static void
+adopt_pending_pins (GstDtmfPinSrc * self)
+{
+  DtmfPinTable *pins = dtmf_pin_table_take (&self->pending_pins);
+  const gchar *function;
+  gint c;
+
+  if (!pins)
+    return;
+
+  dtmf_pin_table_unref (self->pins);
+  self->pins = pins;
+  GST_DEBUG_OBJECT (self, "Switched to new PIN table (%d PINs)",
+      dtmf_pin_table_size (pins));
+
+  for (c = 0; c < ENTRY_CHANNELS (self); c++) {
+    GstDtmfPinSrcChannel *ch = &self->channels[c];
+
+    if (ch->entry.position == 0)
+      continue;
+
+    switch (dtmf_pin_entry_rebase (&ch->entry, pins, &function)) {
+      case DTMF_PIN_MATCH:
+        GST_INFO_OBJECT (self, "PIN matched on channel %d after reload: "
+            "%s -> %s", c, ch->entry.buffer, function);
+        report_pin (self, c, ch->entry.buffer, function, TRUE,
+            ch->last_digit_time);
+        reset_pin_entry (ch);
+        break;
+      case DTMF_PIN_PREFIX:
+        break;
+      case DTMF_PIN_DEAD_END:
+        GST_INFO_OBJECT (self, "No PIN starts with %s on channel %d after "
+            "reload", ch->entry.buffer, c);
+        report_pin (self, c, ch->entry.buffer, NULL, FALSE,
+            ch->last_digit_time);
+        reset_pin_entry (ch);
+        break;
+    }
+  }
 }
 
 /* Property setter */
@@ -247,27 +820,133 @@ gst_dtmf_pin_src_set_property (GObject * object, guint prop_id,
   GstDtmfPinSrc *self = GST_DTMF_PIN_SRC (object);
 
   switch (prop_id) {
-    case PROP_CONFIG_FILE:
-      if (self->config_file)
-        g_free (self->config_file);
-      self->config_file = g_value_dup_string (value);
-      load_pin_config (self, self->config_file);
+    case PROP_CONFIG_FILE:{
+      gchar *filename = g_value_dup_string (value);
+
+      GST_OBJECT_LOCK (self);
+      g_free (self->config_file);
+      self->config_file = g_strdup (filename);
+      GST_OBJECT_UNLOCK (self);
+
+      update_pin_config (self, filename);
+      update_file_monitor (self);
+      g_free (filename);
       break;
+    }
     case PROP_INTER_DIGIT_TIMEOUT:
       self->inter_digit_timeout = g_value_get_uint (value);
       break;
     case PROP_ENTRY_TIMEOUT:
       self->entry_timeout = g_value_get_uint (value);
       break;
-    case PROP_PASS_THROUGH:
-      self->pass_through = g_value_get_boolean (value);
+    case PROP_PASS_THROUGH:{
+      gint old = g_atomic_int_get (&self->pass_through);
+      gint mode = g_value_get_enum (value);
+
+      /* Suppression rewrites the buffers, the other modes only read them */
+      g_atomic_int_set (&self->pass_through, mode);
+      gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (self),
+          mode != GST_DTMF_PIN_SRC_PASS_THROUGH_SUPPRESS);
+
+      if ((old == GST_DTMF_PIN_SRC_PASS_THROUGH_SUPPRESS)
+          != (mode == GST_DTMF_PIN_SRC_PASS_THROUGH_SUPPRESS))
+        gst_element_post_message (GST_ELEMENT (self),
+            gst_message_new_latency (GST_OBJECT (self)));
+      break;
+    }
+    case PROP_SUPPRESS_DELAY:
+      self->suppress_delay = g_value_get_uint (value);
+      break;
+    case PROP_DETECTOR:
+      /* Picked up by the streaming thread on the next buffer */
+      g_atomic_int_set (&self->detector_engine, g_value_get_enum (value));
+      break;
+    case PROP_ENERGY_GATE:
+      /* Picked up by the streaming thread on the next buffer */
+      g_atomic_int_set (&self->energy_gate, g_value_get_boolean (value));
+      break;
+    case PROP_AUTO_RELOAD:
+      self->auto_reload = g_value_get_boolean (value);
+      update_file_monitor (self);
+      break;
+    case PROP_POST_DIGITS:
+      self->post_digits = g_value_get_boolean (value);
+      break;
+    case PROP_POST_MESSAGES:
+      self->post_messages = g_value_get_boolean (value);
+      break;
+    case PROP_EVENT_RING_SIZE:{
+      gboolean stopped;
+
+      /* The consumer reads the ring without a lock, so it is only replaced
+       * while no events can be flowing */
+      g_mutex_lock (&self->entry_lock);
+      GST_OBJECT_LOCK (self);
+      stopped = GST_STATE (self) <= GST_STATE_READY
+          && GST_STATE_PENDING (self) <= GST_STATE_READY;
+      GST_OBJECT_UNLOCK (self);
+
+      if (stopped) {
+        self->event_ring_size = g_value_get_uint (value);
+        dtmf_event_ring_free (self->events);
+        self->events = self->event_ring_size > 0 ?
+            dtmf_event_ring_new (self->event_ring_size,
+            sizeof (GstDtmfPinSrcEvent)) : NULL;
+      }
+      g_mutex_unlock (&self->entry_lock);
+
+      if (!stopped)
+        GST_WARNING_OBJECT (self, "event-ring-size can only be changed in "
+            "the NULL or READY state");
+      break;
+    }
+    case PROP_TIMER_RESOLUTION:
+      dtmf_timer_wheel_set_resolution (g_value_get_uint (value));
+      break;
+    case PROP_SILENCE_MODE:
+      self->silence_mode = g_value_get_enum (value);
+      break;
+    case PROP_DEDUP_WINDOW:
+      g_mutex_lock (&self->entry_lock);
+      self->dedup_window = g_value_get_uint (value);
+      g_mutex_unlock (&self->entry_lock);
+      break;
+    case PROP_THRESHOLD:
+    case PROP_TWIST:
+    case PROP_REVERSE_TWIST:
+    case PROP_FILTER_DIALTONE:
+    case PROP_MIN_DURATION:{
+      DtmfDetectorParams *params = &self->detector_params;
+
+      /* Picked up by the streaming thread on the next buffer */
+      GST_OBJECT_LOCK (self);
+      if (prop_id == PROP_THRESHOLD)
+        params->threshold = g_value_get_double (value);
+      else if (prop_id == PROP_TWIST)
+        params->twist = g_value_get_double (value);
+      else if (prop_id == PROP_REVERSE_TWIST)
+        params->reverse_twist = g_value_get_double (value);
+      else if (prop_id == PROP_FILTER_DIALTONE)
+        params->filter_dialtone = g_value_get_boolean (value);
+      else
+        params->min_duration = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (self);
+      g_atomic_int_inc (&self->params_cookie);
       break;
+    }
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
+/* Value of a level or twist property, which is @def until it is set */
+static gdouble
+param_or_default (gdouble value, gdouble def)
+{
+  return value == DTMF_DETECTOR_PARAM_UNSET ? def : value;
+}
+
 /* Property getter */
 static void
 gst_dtmf_pin_src_get_property (GObject * object, guint prop_id,
@@ -277,7 +956,9 @@ gst_dtmf_pin_src_get_property (GObject * object, guint prop_id,
 
   switch (prop_id) {
     case PROP_CONFIG_FILE:
+      GST_OBJECT_LOCK (self);
       g_value_set_string (value, self->config_file);
+      GST_OBJECT_UNLOCK (self);
       break;
     case PROP_INTER_DIGIT_TIMEOUT:
       g_value_set_uint (value, self->inter_digit_timeout);
@@ -286,7 +967,87 @@ gst_dtmf_pin_src_get_property (GObject * object, guint prop_id,
       g_value_set_uint (value, self->entry_timeout);
       break;
     case PROP_PASS_THROUGH:
-      g_value_set_boolean (value, self->pass_through);
+      g_value_set_enum (value, g_atomic_int_get (&self->pass_through));
+      break;
+    case PROP_SUPPRESS_DELAY:
+      g_value_set_uint (value, self->suppress_delay);
+      break;
+    case PROP_DETECTOR:
+      g_value_set_enum (value, g_atomic_int_get (&self->detector_engine));
+      break;
+    case PROP_ENERGY_GATE:
+      g_value_set_boolean (value, g_atomic_int_get (&self->energy_gate));
+      break;
+    case PROP_SAMPLES_ANALYSED:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint64 (value, self->samples_analysed);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_SAMPLES_SKIPPED:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint64 (value, self->samples_skipped);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_AUTO_RELOAD:
+      g_value_set_boolean (value, self->auto_reload);
+      break;
+    case PROP_POST_DIGITS:
+      g_value_set_boolean (value, self->post_digits);
+      break;
+    case PROP_POST_MESSAGES:
+      g_value_set_boolean (value, self->post_messages);
+      break;
+    case PROP_EVENT_RING_SIZE:
+      g_value_set_uint (value, self->event_ring_size);
+      break;
+    case PROP_EVENTS_DROPPED:
+      g_value_set_uint (value, self->events ?
+          dtmf_event_ring_get_dropped (self->events) : 0);
+      break;
+    case PROP_MESSAGES_POSTED:
+      g_value_set_uint (value, g_atomic_int_get (&self->messages_posted));
+      break;
+    case PROP_TIMER_RESOLUTION:
+      g_value_set_uint (value, dtmf_timer_wheel_get_resolution ());
+      break;
+    case PROP_SILENCE_MODE:
+      g_value_set_enum (value, self->silence_mode);
+      break;
+    case PROP_DEDUP_WINDOW:
+      g_mutex_lock (&self->entry_lock);
+      g_value_set_uint (value, self->dedup_window);
+      g_mutex_unlock (&self->entry_lock);
+      break;
+    case PROP_THRESHOLD:
+      GST_OBJECT_LOCK (self);
+      g_value_set_double (value,
+          param_or_default (self->detector_params.threshold,
+              DTMF_DETECTOR_DEFAULT_THRESHOLD));
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_TWIST:
+      GST_OBJECT_LOCK (self);
+      g_value_set_double (value,
+          param_or_default (self->detector_params.twist,
+              DTMF_DETECTOR_DEFAULT_TWIST));
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_REVERSE_TWIST:
+      GST_OBJECT_LOCK (self);
+      g_value_set_double (value,
+          param_or_default (self->detector_params.reverse_twist,
+              DTMF_DETECTOR_DEFAULT_REVERSE_TWIST));
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_FILTER_DIALTONE:
+      GST_OBJECT_LOCK (self);
+      g_value_set_boolean (value, self->detector_params.filter_dialtone > 0);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_MIN_DURATION:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint (value, self->detector_params.min_duration);
+      GST_OBJECT_UNLOCK (self);
       break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -300,340 +1061,1498 @@ static gboolean
       GstCaps * incaps, GstCaps * outcaps)
 {
   GstDtmfPinSrc *self = GST_DTMF_PIN_SRC (trans);
-  GstStructure *s;
-  gint rate, channels;
+  GstAudioInfo info;
+  DtmfG711Law law;
   gboolean success = TRUE;
+  gint n_channels;
+  gint c;
 
   /* Log caps information for debugging */
   GST_DEBUG_OBJECT (self, "Input caps: %" GST_PTR_FORMAT, incaps);
   GST_DEBUG_OBJECT (self, "Output caps: %" GST_PTR_FORMAT, outcaps);
 
-  /* Extract and verify input caps parameters */
-  if (incaps) {
-    s = gst_caps_get_structure (incaps, 0);
-    if (s) {
-      if (gst_structure_get_int (s, "rate", &rate)) {
-        GST_DEBUG_OBJECT (self, "Input sample rate: %d Hz", rate);
-        /* Verify sample rate is 8000Hz for proper DTMF detection */
-        if (rate != 8000) {
-          GST_WARNING_OBJECT (self, "Sample rate is %d Hz, 8000 Hz is recommended for DTMF", rate);
-        }
-      }
-      if (gst_structure_get_int (s, "channels", &channels)) {
-        GST_DEBUG_OBJECT (self, "Input channels: %d", channels);
-      }
-    }
+  if (!dtmf_g711_info_from_caps (incaps, &info, &law)) {
+    GST_ERROR_OBJECT (self, "Invalid input caps");
+    return FALSE;
   }
 
-  /* Extract and verify output caps parameters */
-  if (outcaps) {
-    s = gst_caps_get_structure (outcaps, 0);
-    if (s) {
-      if (gst_structure_get_int (s, "rate", &rate)) {
-        GST_DEBUG_OBJECT (self, "Output sample rate: %d Hz", rate);
-      }
-      if (gst_structure_get_int (s, "channels", &channels)) {
-        GST_DEBUG_OBJECT (self, "Output channels: %d", channels);
+  GST_DEBUG_OBJECT (self, "Input sample rate: %d Hz, channels: %d",
+      GST_AUDIO_INFO_RATE (&info), GST_AUDIO_INFO_CHANNELS (&info));
+
+  /* Rebuild the analysis front end when the input layout changes */
+  g_mutex_lock (&self->entry_lock);
+  if (GST_AUDIO_INFO_RATE (&info) != GST_AUDIO_INFO_RATE (&self->info)
+      || GST_AUDIO_INFO_CHANNELS (&info) != self->n_channels) {
+    n_channels = MIN (GST_AUDIO_INFO_CHANNELS (&info),
+        DTMF_PIN_SRC_MAX_CHANNELS);
+
+    for (c = 0; c < DTMF_PIN_SRC_MAX_CHANNELS; c++) {
+      GstDtmfPinSrcChannel *ch = &self->channels[c];
+
+      dtmf_decimator_free (ch->decimator);
+      ch->decimator = NULL;
+
+      if (c >= n_channels) {
+        /* Unused channels must not hold on to a batch engine lane */
+        dtmf_detector_free (ch->detector);
+        ch->detector = NULL;
+        continue;
       }
+
+      if (GST_AUDIO_INFO_RATE (&info) != DTMF_ANALYSIS_RATE)
+        ch->decimator = dtmf_decimator_new (GST_AUDIO_INFO_RATE (&info));
+      reset_pin_entry (ch);
+    }
+    self->n_channels = n_channels;
+
+    if (GST_AUDIO_INFO_RATE (&info) != DTMF_ANALYSIS_RATE) {
+      GST_DEBUG_OBJECT (self, "Decimating %d Hz to %d Hz for analysis",
+          GST_AUDIO_INFO_RATE (&info), DTMF_ANALYSIS_RATE);
     }
   }
+  self->info = info;
+  self->g711 = dtmf_g711_table (law);
+  self->silence = dtmf_g711_silence (law);
+
+  /* Size the suppress mode delay line for the new format */
+  self->delay_frames = gst_util_uint64_scale_int (self->suppress_delay,
+      GST_AUDIO_INFO_RATE (&info), 1000);
+  g_free (self->delay_line);
+  g_free (self->delay_scratch);
+  self->delay_line = g_malloc (self->delay_frames *
+      GST_AUDIO_INFO_BPF (&info));
+  memset (self->delay_line, self->silence, self->delay_frames *
+      GST_AUDIO_INFO_BPF (&info));
+  self->delay_scratch = g_malloc (self->delay_frames *
+      GST_AUDIO_INFO_BPF (&info));
+  self->delay_fill = 0;
 
   /* Initialize DTMF state if not already done */
-  if (!self->dtmf_state) {
-    self->dtmf_state = dtmf_rx_init (NULL, NULL, NULL);
-    if (!self->dtmf_state) {
+  for (c = 0; c < self->n_channels; c++) {
+    GstDtmfPinSrcChannel *ch = &self->channels[c];
+
+    if (ch->detector)
+      continue;
+
+    ch->detector =
+        dtmf_detector_new (g_atomic_int_get (&self->detector_engine));
+    if (!ch->detector) {
       GST_ERROR_OBJECT (self, "Failed to initialize DTMF detector");
       success = FALSE;
-    } else {
-      GST_DEBUG_OBJECT (self, "DTMF detector initialized");
+      break;
     }
+    tune_detector (self, ch);
   }
 
+  update_stall_timer (self);
+  g_mutex_unlock (&self->entry_lock);
+
+  if (success)
+    GST_DEBUG_OBJECT (self, "DTMF detectors initialized for %d channels",
+        self->n_channels);
+
   return success;
 }
-/* Transform in-place */
-static GstFlowReturn
-gst_dtmf_pin_src_transform_ip (GstBaseTransform * trans, GstBuffer * buf)
-{
-  GstDtmfPinSrc *self = GST_DTMF_PIN_SRC (trans);
-  gint dtmf_count;
-  gchar dtmfbuf[MAX_DTMF_DIGITS] = "";
-  gint i;
-  GstMapInfo map;
-
-  if (GST_BUFFER_IS_DISCONT (buf))
-    gst_dtmf_pin_src_state_reset (self);
-  if (GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_GAP))
-    return GST_FLOW_OK;
 
-  gst_buffer_map (buf, &map, GST_MAP_READ);
+/* Hand the tuning properties to the detector of @ch. A change that comes
+ * in meanwhile bumps the cookie again and is applied next time. */
+static void
+tune_detector (GstDtmfPinSrc * self, GstDtmfPinSrcChannel * ch)
+{
+  DtmfDetectorParams params;
 
-  dtmf_rx (self->dtmf_state, (gint16 *) map.data, map.size / 2);
+  ch->params_cookie = g_atomic_int_get (&self->params_cookie);
+  GST_OBJECT_LOCK (self);
+  params = self->detector_params;
+  GST_OBJECT_UNLOCK (self);
 
-  dtmf_count = dtmf_rx_get (self->dtmf_state, dtmfbuf, MAX_DTMF_DIGITS);
+  dtmf_detector_set_params (ch->detector, &params);
+}
 
-  if (dtmf_count) {
-    GST_DEBUG_OBJECT (self, "Got %d DTMF events: %s", dtmf_count, dtmfbuf);
-  } else {
-    GST_LOG_OBJECT (self, "Got no DTMF events");
+/* Switch detection engine if the detector property changed, and follow
+ * the energy-gate and tuning properties */
+static void
+update_detector (GstDtmfPinSrc * self, GstDtmfPinSrcChannel * ch)
+{
+  DtmfDetectorEngine engine = g_atomic_int_get (&self->detector_engine);
+  DtmfDetector *detector;
+  gboolean fresh = FALSE;
+
+  if (!ch->detector || dtmf_detector_get_engine (ch->detector) != engine) {
+    detector = dtmf_detector_new (engine);
+    if (detector) {
+      dtmf_detector_free (ch->detector);
+      ch->detector = detector;
+      fresh = TRUE;
+      GST_DEBUG_OBJECT (self, "Switched DTMF detector engine to %d", engine);
+    } else {
+      GST_WARNING_OBJECT (self,
+          "Failed to create detector, keeping current one");
+    }
   }
 
-  gst_buffer_unmap (buf, &map);
+  if (!ch->detector)
+    return;
 
-  /* Process each DTMF digit */
-  for (i = 0; i < dtmf_count; i++) {
-    process_dtmf_digit (self, dtmfbuf[i]);
-  }
+  dtmf_detector_set_gate (ch->detector,
+      g_atomic_int_get (&self->energy_gate));
+  if (fresh || ch->params_cookie != g_atomic_int_get (&self->params_cookie))
+    tune_detector (self, ch);
+}
 
-  /* Handle pass-through */
-  if (!self->pass_through) {
-    /* If pass-through is disabled, replace audio with silence */
-    GstMapInfo map_info;
-    
-    if (gst_buffer_map (buf, &map_info, GST_MAP_WRITE)) {
-      memset (map_info.data, 0, map_info.size);
-      gst_buffer_unmap (buf, &map_info);
+/* Make sure the analysis scratch buffers can hold one input buffer */
+static void
+ensure_analysis_buffers (GstDtmfPinSrc * self, gsize n_frames)
+{
+  GstDtmfPinSrcChannel *ch = &self->channels[0];
+  gsize needed;
+
+  if (ch->decimator) {
+    needed = dtmf_decimator_max_output (ch->decimator, n_frames);
+    if (needed > self->analysis_size) {
+      g_free (self->analysis);
+      self->analysis = g_new (gint16, needed);
+      self->analysis_size = needed;
+    }
+  } else if (self->n_channels > 1
+      && GST_AUDIO_INFO_FORMAT (&self->info) == GST_AUDIO_FORMAT_S16) {
+    needed = n_frames * self->n_channels;
+    if (needed > self->planar_size) {
+      g_free (self->planar);
+      self->planar = g_new (gint16, needed);
+      self->planar_size = needed;
     }
-    
-    return GST_FLOW_OK;
   }
-  
-  /* Pass-through enabled - let audio continue */
-  return GST_FLOW_OK;
 }
 
-/* Sink event handler */
-static gboolean
-gst_dtmf_pin_src_sink_event (GstBaseTransform * trans, GstEvent * event)
+/* Get the 8 kHz analysis samples of @channel for a mapped input buffer.
+ * Returns a pointer into the buffer data itself, the deinterleaved planes
+ * or the decimator output, or NULL for 8 kHz input that is not S16, which
+ * is converted one tick at a time by extract_tick() as it is analysed. */
+static const gint16 *
+prepare_analysis_samples (GstDtmfPinSrc * self, gint channel,
+    const guint8 * in, gsize n_frames, gsize * n_samples)
 {
-  GstDtmfPinSrc *self = GST_DTMF_PIN_SRC (trans);
-
-  switch (GST_EVENT_TYPE (event)) {
-    case GST_EVENT_FLUSH_STOP:
-      gst_dtmf_pin_src_state_reset (self);
-      break;
-    default:
-      break;
+  GstDtmfPinSrcChannel *ch = &self->channels[channel];
+  gint channels = GST_AUDIO_INFO_CHANNELS (&self->info);
+
+  /* The decimator reads its channel straight from the interleaved input */
+  if (ch->decimator) {
+    switch (GST_AUDIO_INFO_FORMAT (&self->info)) {
+      case GST_AUDIO_FORMAT_S32:
+        *n_samples = dtmf_decimator_process_s32 (ch->decimator,
+            (const gint32 *) in + channel, n_frames, channels,
+            self->analysis);
+        break;
+      case GST_AUDIO_FORMAT_F32:
+        *n_samples = dtmf_decimator_process_f32 (ch->decimator,
+            (const gfloat *) in + channel, n_frames, channels,
+            self->analysis);
+        break;
+      default:
+        *n_samples = dtmf_decimator_process (ch->decimator,
+            (const gint16 *) in + channel, n_frames, channels,
+            self->analysis);
+        break;
+    }
+    return self->analysis;
   }
 
-  return GST_BASE_TRANSFORM_CLASS (gst_dtmf_pin_src_parent_class)->sink_event (trans, event);
+  *n_samples = n_frames;
+  if (GST_AUDIO_INFO_FORMAT (&self->info) != GST_AUDIO_FORMAT_S16)
+    return NULL;
+  if (channels == 1)
+    return (const gint16 *) in;
+
+  return self->planar + channel * n_frames;
 }
 
-/* Load PIN configuration from file */
-static gboolean
-load_pin_config (GstDtmfPinSrc * self, const gchar * filename)
+/* Convert @len frames of @channel from frame @pos of 8 kHz input that
+ * prepare_analysis_samples() left alone into @out */
+static void
+extract_tick (GstDtmfPinSrc * self, const guint8 * in, gsize pos, gsize len,
+    gint channel, gint16 * out)
 {
-  FILE *file;
-  gchar line[512];
-  gint line_num = 0;
+  gint channels = GST_AUDIO_INFO_CHANNELS (&self->info);
+  gsize offset = pos * channels + channel;
 
-  file = fopen (filename, "r");
-  if (!file) {
-    GST_WARNING_OBJECT (self, "Could not open PIN config file: %s", filename);
-    return FALSE;
+  if (self->g711) {
+    dtmf_g711_expand (self->g711, in + offset, len, channels, out);
+    return;
   }
 
-  self->pin_count = 0;
-
-  while (fgets (line, sizeof (line), file) && self->pin_count < MAX_PINS) {
-    line_num++;
-
-    /* Remove trailing newline */
-    line[strcspn (line, "\r\n")] = 0;
-
-    /* Skip empty lines and comments */
-    if (line[0] == '\0' || line[0] == ';')
-      continue;
+  switch (GST_AUDIO_INFO_FORMAT (&self->info)) {
+    case GST_AUDIO_FORMAT_S32:
+      dtmf_deinterleave_channel_s32 ((const gint32 *) in + offset, len,
+          channels, out);
+      break;
+    case GST_AUDIO_FORMAT_F32:
+      dtmf_deinterleave_channel_f32 ((const gfloat *) in + offset, len,
+          channels, out);
+      break;
+    default:
+      g_assert_not_reached ();
+      break;
+  }
+}
 
-    /* Parse PIN=function format */
-    gchar *equal = strchr (line, '=');
-    if (!equal) {
-      GST_WARNING_OBJECT (self, "Invalid line %d: missing '='", line_num);
-      continue;
-    }
+/* Move the stream clock over a buffer or gap at @pts lasting @duration
+ * and return the running time it starts at. Timestamps are taken in the
+ * running time of the input segment; data without a timestamp follows on
+ * from the previous buffer, so the timeouts work on any input and do not
+ * depend on how fast it is processed. */
+static GstClockTime
+advance_running_time (GstDtmfPinSrc * self, GstClockTime pts,
+    GstClockTime duration)
+{
+  GstSegment *segment = &GST_BASE_TRANSFORM (self)->segment;
+  GstClockTime time = GST_CLOCK_TIME_NONE;
 
-    *equal = '\0';
-    gchar *pin = g_strstrip (line);
-    gchar *function = g_strstrip (equal + 1);
+  if (GST_CLOCK_TIME_IS_VALID (pts) && segment->format == GST_FORMAT_TIME)
+    time = gst_segment_to_running_time (segment, GST_FORMAT_TIME, pts);
+  if (!GST_CLOCK_TIME_IS_VALID (time))
+    time = GST_CLOCK_TIME_IS_VALID (self->running_time) ?
+        self->running_time : 0;
 
-    if (strlen (pin) == 0 || strlen (function) == 0) {
-      GST_WARNING_OBJECT (self, "Invalid line %d: empty PIN or function", line_num);
-      continue;
-    }
+  self->running_time = time;
+  if (GST_CLOCK_TIME_IS_VALID (duration))
+    self->running_time += duration;
 
-    if (strlen (pin) > MAX_PIN_LENGTH) {
-      GST_WARNING_OBJECT (self, "Line %d: PIN too long (max %d)", line_num,
-          MAX_PIN_LENGTH);
-      continue;
-    }
+  return time;
+}
 
-    strncpy (self->pins[self->pin_count].pin, pin, MAX_PIN_LENGTH);
-    strncpy (self->pins[self->pin_count].function, function, 255);
-    self->pins[self->pin_count].function[255] = '\0';
-    self->pin_count++;
+/* Duration of @buf, from its sample count when it has none */
+static GstClockTime
+buffer_duration (GstDtmfPinSrc * self, GstBuffer * buf)
+{
+  gint bpf = GST_AUDIO_INFO_BPF (&self->info);
 
-    GST_INFO_OBJECT (self, "Loaded PIN: %s -> %s", pin, function);
-  }
+  if (GST_BUFFER_DURATION_IS_VALID (buf))
+    return GST_BUFFER_DURATION (buf);
+  if (bpf == 0 || GST_AUDIO_INFO_RATE (&self->info) == 0)
+    return GST_CLOCK_TIME_NONE;
 
-  fclose (file);
-  GST_INFO_OBJECT (self, "Loaded %d PIN codes from %s", self->pin_count, filename);
-  return TRUE;
+  return gst_util_uint64_scale_int (gst_buffer_get_size (buf) / bpf,
+      GST_SECOND, GST_AUDIO_INFO_RATE (&self->info));
 }
 
-/* Reset PIN entry state */
+/* Silence @channel of interleaved frames @from to @to */
 static void
-reset_pin_entry (GstDtmfPinSrc * self)
+mute_frames (GstDtmfPinSrc * self, guint8 * data, gsize from, gsize to,
+    gint channel)
 {
-  memset (self->pin_buffer, 0, sizeof (self->pin_buffer));
-  self->pin_position = 0;
-  g_timer_start (self->inter_digit_timer);
-  g_timer_start (self->entry_timer);
-  GST_DEBUG_OBJECT (self, "PIN entry reset");
-}
+  gint channels = GST_AUDIO_INFO_CHANNELS (&self->info);
+  gint bpf = GST_AUDIO_INFO_BPF (&self->info);
+  gint bps = bpf / channels;
+  gsize i;
 
-/* Check if current PIN buffer matches any configured PIN */
-static gboolean
-check_pin_match (GstDtmfPinSrc * self)
-{
-  gint i;
+  if (from >= to)
+    return;
 
-  for (i = 0; i < self->pin_count; i++) {
-    if (strcmp (self->pin_buffer, self->pins[i].pin) == 0) {
-      GST_INFO_OBJECT (self, "PIN matched: %s -> %s", self->pin_buffer,
-          self->pins[i].function);
-      emit_pin_detected_message (self, self->pin_buffer,
-          self->pins[i].function, TRUE);
-      return TRUE;
-    }
+  if (channels == 1) {
+    memset (data + from * bpf, self->silence, (to - from) * bpf);
+    return;
   }
 
-  GST_INFO_OBJECT (self, "No match for PIN: %s", self->pin_buffer);
-  emit_pin_detected_message (self, self->pin_buffer, NULL, FALSE);
-  return FALSE;
+  /* Zero bytes are silence for every PCM format, G.711 has its own code */
+  for (i = from; i < to; i++)
+    memset (data + i * bpf + channel * bps, self->silence, bps);
 }
 
-/* Emit bus message for PIN detection */
+/* Mute @channel over the @span frames before frame @end of the current
+ * buffer, reaching back into the delay line for frames that came with
+ * earlier buffers */
 static void
-emit_pin_detected_message (GstDtmfPinSrc * self, const gchar * pin,
-    const gchar * function, gboolean valid)
+mute_span (GstDtmfPinSrc * self, gint channel, guint8 * data, gsize end,
+    gsize span)
 {
-  GstStructure *structure;
-  GstMessage *message;
-
-  structure = gst_structure_new ("pin-detected", "pin", G_TYPE_STRING, pin,
-      "function", G_TYPE_STRING, function ? function : "", "valid",
-      G_TYPE_BOOLEAN, valid, NULL);
+  gsize back;
 
-  message = gst_message_new_element (GST_OBJECT (self), structure);
-  gst_element_post_message (GST_ELEMENT (self), message);
+  mute_frames (self, data, end > span ? end - span : 0, end, channel);
 
-  GST_DEBUG_OBJECT (self, "Emitted pin-detected message: pin=%s function=%s valid=%d",
-      pin, function ? function : "", valid);
+  if (span > end) {
+    back = MIN (span - end, self->delay_fill);
+    mute_frames (self, self->delay_line, self->delay_fill - back,
+        self->delay_fill, channel);
+  }
 }
 
-/* Process a single DTMF digit */
+/* Remember a digit recognised in the @len analysis samples from @offset,
+ * for the next output buffer to carry */
 static void
-process_dtmf_digit (GstDtmfPinSrc * self, gchar digit)
+queue_digit_meta (GstDtmfPinSrc * self, gint channel, gchar digit,
+    guint64 offset, gsize len, GstClockTime time)
 {
-  gdouble elapsed;
+  gint rate = GST_AUDIO_INFO_RATE (&self->info);
+  GstDtmfPinSrcDigit d;
+
+  d.digit = digit;
+  d.channel = channel;
+  d.start = gst_util_uint64_scale_int (offset, rate, DTMF_ANALYSIS_RATE);
+  d.end = gst_util_uint64_scale_int (offset + len, rate, DTMF_ANALYSIS_RATE);
+  d.time = time;
+  g_array_append_val (self->pending_digits, d);
+}
 
-  /* Update timing tracking */
-  if (self->last_digit_timer) {
-    elapsed = g_timer_elapsed (self->last_digit_timer, NULL) * 1000.0;
-    self->last_digit_interval = elapsed;
-    g_timer_start (self->last_digit_timer);
-  }
+/* Attach the digits recognised since the last output buffer to @buf */
+static GstBuffer *
+attach_digit_metas (GstDtmfPinSrc * self, GstBuffer * buf)
+{
+  guint i;
 
-  GST_DEBUG_OBJECT (self, "Processing digit: %c (current buffer: '%s')", digit,
-      self->pin_buffer);
+  if (self->pending_digits->len == 0)
+    return buf;
 
-  /* Add digit to buffer if there's space */
-  if (self->pin_position < PIN_BUFFER_SIZE - 1) {
-    self->pin_buffer[self->pin_position++] = digit;
-    self->pin_buffer[self->pin_position] = '\0';
+  buf = gst_buffer_make_writable (buf);
+  for (i = 0; i < self->pending_digits->len; i++) {
+    GstDtmfPinSrcDigit *d = &g_array_index (self->pending_digits,
+        GstDtmfPinSrcDigit, i);
 
-    /* Check if this matches any PIN */
-    if (check_pin_match (self)) {
-      /* PIN matched - reset buffer */
-      reset_pin_entry (self);
-    } else {
-      /* No match - keep accumulating */
-      g_timer_start (self->inter_digit_timer);
-    }
-  } else {
-    /* Buffer full - reset */
-    GST_WARNING_OBJECT (self, "PIN buffer full, resetting");
-    reset_pin_entry (self);
+    gst_buffer_add_dtmf_digit_meta (buf, d->digit, d->channel, d->start,
+        d->end, d->time);
   }
+  g_array_set_size (self->pending_digits, 0);
+
+  return buf;
+}
+
+/* Run detection over one buffer, with entry_lock held. With @suppress the
+ * buffer is writable and tones found in it are muted as they are found. */
+static GstFlowReturn
+process_buffer (GstDtmfPinSrc * self, GstBuffer * buf, gboolean suppress)
+{
+  gint dtmf_count;
+  gchar dtmfbuf[DTMF_DETECTOR_MAX_DIGITS] = "";
+  gint i, c;
+  GstMapInfo map;
+  const gint16 *samples, *piece;
+  gint16 tick[DTMF_PIN_SRC_TICK_SAMPLES];
+  gsize n_frames;
+  gsize n_samples;
+  gsize pos, len;
+  gsize lookback;
+  guint64 skipped = 0;
+  GstClockTime start, now;
+
+  if (GST_BUFFER_IS_DISCONT (buf))
+    gst_dtmf_pin_src_state_reset (self);
+  adopt_pending_pins (self);
+
+  start = advance_running_time (self, GST_BUFFER_PTS (buf),
+      buffer_duration (self, buf));
+
+  if (GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_GAP)) {
+    check_timeouts (self, self->running_time);
+    return GST_FLOW_OK;
+  }
+
+  if (self->n_channels == 0)
+    return GST_FLOW_NOT_NEGOTIATED;
+
+  for (c = 0; c < self->n_channels; c++) {
+    update_detector (self, &self->channels[c]);
+    if (!self->channels[c].detector)
+      return GST_FLOW_NOT_NEGOTIATED;
+  }
+
+  gst_buffer_map (buf, &map, suppress ? GST_MAP_READWRITE : GST_MAP_READ);
+
+  n_frames = map.size / GST_AUDIO_INFO_BPF (&self->info);
+  ensure_analysis_buffers (self, n_frames);
+
+  /* Split 8 kHz multichannel input once for all channels */
+  if (!self->channels[0].decimator && self->n_channels > 1
+      && GST_AUDIO_INFO_FORMAT (&self->info) == GST_AUDIO_FORMAT_S16)
+    dtmf_deinterleave_s16 ((const gint16 *) map.data, n_frames,
+        self->n_channels, self->planar);
+
+  for (c = 0; c < self->n_channels; c++) {
+    GstDtmfPinSrcChannel *ch = &self->channels[c];
+
+    samples = prepare_analysis_samples (self, c, map.data, n_frames,
+        &n_samples);
+    skipped -= dtmf_detector_get_skipped (ch->detector);
+
+    /* Analyse in ticks counted from the start of the stream rather than in
+     * whatever buffers upstream happens to push. Digits count as entered
+     * at the end of their tick and timeouts that expire up to then are
+     * handled first, so a late digit starts a new entry rather than
+     * extending a stale one. This makes the result depend only on the
+     * audio, not on the buffer size or on how fast it is processed. */
+    for (pos = 0; pos < n_samples; pos += len) {
+      len = DTMF_PIN_SRC_TICK_SAMPLES -
+          (self->analysis_offset + pos) % DTMF_PIN_SRC_TICK_SAMPLES;
+      len = MIN (len, n_samples - pos);
+      now = start + gst_util_uint64_scale_int (pos + len, GST_SECOND,
+          DTMF_ANALYSIS_RATE);
+
+      check_channel_timeouts (self, c, now);
+
+      if (samples) {
+        piece = samples + pos;
+      } else {
+        extract_tick (self, map.data, pos, len, c, tick);
+        piece = tick;
+      }
+
+      dtmf_count = dtmf_detector_process (ch->detector, piece, len,
+          dtmfbuf, DTMF_DETECTOR_MAX_DIGITS);
+
+      if (dtmf_count) {
+        GST_DEBUG_OBJECT (self, "Got %d DTMF events on channel %d: %s",
+            dtmf_count, c, dtmfbuf);
+      }
+
+      /* Process each DTMF digit */
+      for (i = 0; i < dtmf_count; i++) {
+        queue_digit_meta (self, c, dtmfbuf[i], self->analysis_offset + pos,
+            len, now);
+        if (!duplicate_digit (self, c, dtmfbuf[i], now, FALSE))
+          process_dtmf_digit (self, c, dtmfbuf[i], now);
+      }
+
+      /* A tone is reported a couple of blocks after it starts. Mute the
+       * piece just analysed and the lookahead before it, which has not
+       * left the element yet. */
+      if (suppress && dtmf_detector_in_tone (ch->detector)) {
+        lookback = gst_util_uint64_scale_int (len,
+            GST_AUDIO_INFO_RATE (&self->info), DTMF_ANALYSIS_RATE) +
+            self->delay_frames;
+        mute_span (self, c, map.data,
+            (pos + len) * n_frames / n_samples, lookback);
+      }
+    }
+    skipped += dtmf_detector_get_skipped (ch->detector);
+  }
+  self->analysis_offset += n_samples;
+
+  GST_OBJECT_LOCK (self);
+  self->samples_analysed += n_samples * self->n_channels;
+  self->samples_skipped += skipped;
+  GST_OBJECT_UNLOCK (self);
+
+  gst_buffer_unmap (buf, &map);
+
+  return GST_FLOW_OK;
+}
+
+/* Swap @n_frames frames at @data with the delay line, which must be full:
+ * @data comes out as the oldest @n_frames of the line followed by the
+ * input, and the line keeps the newest frames */
+static void
+delay_line_swap (GstDtmfPinSrc * self, guint8 * data, gsize n_frames)
+{
+  gsize bpf = GST_AUDIO_INFO_BPF (&self->info);
+  gsize d = self->delay_frames * bpf;
+  gsize n = n_frames * bpf;
+  guint8 *line = self->delay_line;
+  guint8 *scratch = self->delay_scratch;
+
+  if (d == 0)
+    return;
+
+  if (n >= d) {
+    memcpy (scratch, data + n - d, d);
+    memmove (data + d, data, n - d);
+    memcpy (data, line, d);
+    memcpy (line, scratch, d);
+  } else {
+    memcpy (scratch, data, n);
+    memcpy (data, line, n);
+    memmove (line, line + n, d - n);
+    memcpy (line + d - n, scratch, n);
+  }
+}
+
+/* Delay a suppress mode buffer by the lookahead, in place. The output
+ * carries the time of the audio it holds now, so it is late by the
+ * lookahead, which the latency query reports. While the line fills up at
+ * the start of a stream the output is shortened or dropped. */
+static GstFlowReturn
+delay_buffer (GstDtmfPinSrc * self, GstBuffer * buf)
+{
+  gsize bpf = GST_AUDIO_INFO_BPF (&self->info);
+  gint rate = GST_AUDIO_INFO_RATE (&self->info);
+  gsize fill = self->delay_fill;
+  gsize pad = 0;
+  gsize n_frames;
+  GstClockTime shift;
+  GstMapInfo map;
+
+  if (bpf == 0)
+    return GST_FLOW_NOT_NEGOTIATED;
+
+  gst_buffer_map (buf, &map, GST_MAP_READWRITE);
+  n_frames = map.size / bpf;
+
+  if (GST_BUFFER_PTS_IS_VALID (buf))
+    self->delay_end = GST_BUFFER_PTS (buf) +
+        gst_util_uint64_scale_int (n_frames, GST_SECOND, rate);
+
+  if (fill + n_frames <= self->delay_frames) {
+    memcpy (self->delay_line + fill * bpf, map.data, n_frames * bpf);
+    self->delay_fill += n_frames;
+    gst_buffer_unmap (buf, &map);
+    return GST_BASE_TRANSFORM_FLOW_DROPPED;
+  }
+
+  /* Fill the rest of the line with silence that is cut off again below */
+  if (fill < self->delay_frames) {
+    pad = self->delay_frames - fill;
+    memmove (self->delay_line + pad * bpf, self->delay_line, fill * bpf);
+    memset (self->delay_line, self->silence, pad * bpf);
+    self->delay_fill = self->delay_frames;
+  }
+
+  delay_line_swap (self, map.data, n_frames);
+  gst_buffer_unmap (buf, &map);
+
+  if (pad > 0) {
+    gst_buffer_resize (buf, pad * bpf, -1);
+    if (GST_BUFFER_DURATION_IS_VALID (buf))
+      GST_BUFFER_DURATION (buf) = gst_util_uint64_scale_int (n_frames - pad,
+          GST_SECOND, rate);
+  }
+
+  shift = gst_util_uint64_scale_int (fill, GST_SECOND, rate);
+  if (GST_BUFFER_PTS_IS_VALID (buf))
+    GST_BUFFER_PTS (buf) = GST_BUFFER_PTS (buf) > shift ?
+        GST_BUFFER_PTS (buf) - shift : 0;
+
+  /* Audio from an earlier buffer may have moved into a gap */
+  GST_BUFFER_FLAG_UNSET (buf, GST_BUFFER_FLAG_GAP);
+
+  return GST_FLOW_OK;
+}
+
+/* Push what is left in the delay line, at the end of the stream or when
+ * suppress mode is left */
+static void
+drain_delay_line (GstDtmfPinSrc * self)
+{
+  gsize bpf = GST_AUDIO_INFO_BPF (&self->info);
+  gint rate = GST_AUDIO_INFO_RATE (&self->info);
+  GstClockTime duration;
+  GstBuffer *buf;
+
+  if (self->delay_fill == 0 || rate == 0)
+    return;
+
+  buf = gst_buffer_new_memdup (self->delay_line, self->delay_fill * bpf);
+  duration = gst_util_uint64_scale_int (self->delay_fill, GST_SECOND, rate);
+  if (GST_CLOCK_TIME_IS_VALID (self->delay_end))
+    GST_BUFFER_PTS (buf) = self->delay_end > duration ?
+        self->delay_end - duration : 0;
+  GST_BUFFER_DURATION (buf) = duration;
+  self->delay_fill = 0;
+
+  buf = attach_digit_metas (self, buf);
+  gst_pad_push (GST_BASE_TRANSFORM_SRC_PAD (self), buf);
+}
+
+/* Transform in-place */
+static GstFlowReturn
+gst_dtmf_pin_src_transform_ip (GstBaseTransform * trans, GstBuffer * buf)
+{
+  GstDtmfPinSrc *self = GST_DTMF_PIN_SRC (trans);
+  GstFlowReturn ret;
+  GArray *reports;
+  gboolean suppress;
+
+  /* The buffer is only writable once the base class has seen the switch
+   * out of passthrough. Audio still in the delay line from suppress mode
+   * goes out ahead of it. */
+  suppress = g_atomic_int_get (&self->pass_through) ==
+      GST_DTMF_PIN_SRC_PASS_THROUGH_SUPPRESS && gst_buffer_is_writable (buf);
+  if (!suppress)
+    drain_delay_line (self);
+
+  g_mutex_lock (&self->entry_lock);
+  ret = process_buffer (self, buf, suppress);
+  update_stall_timer (self);
+  reports = take_reports (self);
+  g_mutex_unlock (&self->entry_lock);
+  emit_reports (self, reports);
+
+  if (ret == GST_FLOW_OK && suppress)
+    ret = delay_buffer (self, buf);
+
+  return ret;
+}
+
+/* Output of a muted element. Detection has already run on the input by
+ * the time the base class hands the buffer over here. */
+static GstFlowReturn
+gst_dtmf_pin_src_generate_output (GstBaseTransform * trans,
+    GstBuffer ** outbuf)
+{
+  GstDtmfPinSrc *self = GST_DTMF_PIN_SRC (trans);
+  GstFlowReturn ret;
+  GstBuffer *buf, *silent;
+  GstClockTime duration;
+
+  ret = GST_BASE_TRANSFORM_CLASS (gst_dtmf_pin_src_parent_class)->
+      generate_output (trans, outbuf);
+
+  buf = *outbuf;
+  if (ret != GST_FLOW_OK || !buf)
+    return ret;
+
+  if (g_atomic_int_get (&self->pass_through) !=
+      GST_DTMF_PIN_SRC_PASS_THROUGH_FALSE) {
+    *outbuf = attach_digit_metas (self, buf);
+    return GST_FLOW_OK;
+  }
+
+  switch (self->silence_mode) {
+    case GST_DTMF_PIN_SRC_SILENCE_ZERO:
+      /* Copies the buffer first if upstream still holds it */
+      buf = gst_buffer_make_writable (buf);
+      gst_buffer_memset (buf, 0, self->silence, gst_buffer_get_size (buf));
+      break;
+    case GST_DTMF_PIN_SRC_SILENCE_GAP:
+      silent = dtmf_silence_buffer_new_filled (gst_buffer_get_size (buf),
+          self->silence);
+      gst_buffer_copy_into (silent, buf, GST_BUFFER_COPY_FLAGS |
+          GST_BUFFER_COPY_TIMESTAMPS | GST_BUFFER_COPY_META, 0, -1);
+      GST_BUFFER_FLAG_SET (silent, GST_BUFFER_FLAG_GAP);
+      gst_buffer_unref (buf);
+      buf = silent;
+      break;
+    case GST_DTMF_PIN_SRC_SILENCE_DROP:
+      /* Nothing is pushed, downstream only learns the time has passed */
+      duration = buffer_duration (self, buf);
+      if (GST_BUFFER_PTS_IS_VALID (buf))
+        gst_pad_push_event (GST_BASE_TRANSFORM_SRC_PAD (trans),
+            gst_event_new_gap (GST_BUFFER_PTS (buf), duration));
+      gst_buffer_unref (buf);
+      buf = NULL;
+      /* No buffer to carry the digits, the bus messages still do */
+      g_array_set_size (self->pending_digits, 0);
+      break;
+  }
+
+  *outbuf = buf ? attach_digit_metas (self, buf) : NULL;
+  return GST_FLOW_OK;
 }
 
-/* Continuous timeout checking */
+/* Sink event handler */
 static gboolean
-check_timeouts_continuously (GstDtmfPinSrc * self)
+gst_dtmf_pin_src_sink_event (GstBaseTransform * trans, GstEvent * event)
 {
-  gdouble inter_digit_elapsed, entry_elapsed;
+  GstDtmfPinSrc *self = GST_DTMF_PIN_SRC (trans);
+  GArray *reports;
+  gboolean hold;
 
-  if (!self->inter_digit_timer || !self->entry_timer)
-    return TRUE;
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_FLUSH_STOP:
+      g_mutex_lock (&self->entry_lock);
+      gst_dtmf_pin_src_state_reset (self);
+      self->running_time = GST_CLOCK_TIME_NONE;
+      gst_event_replace (&self->held_eos, NULL);
+      update_stall_timer (self);
+      g_mutex_unlock (&self->entry_lock);
+      break;
+    case GST_EVENT_GAP:{
+      GstClockTime timestamp, duration;
+
+      /* No audio for a while, time still runs out for pending entries */
+      gst_event_parse_gap (event, &timestamp, &duration);
+      g_mutex_lock (&self->entry_lock);
+      advance_running_time (self, timestamp, duration);
+      check_timeouts (self, self->running_time);
+      update_stall_timer (self);
+      reports = take_reports (self);
+      g_mutex_unlock (&self->entry_lock);
+      emit_reports (self, reports);
+      break;
+    }
+    case GST_EVENT_EOS:
+      /* The stream is over, not stalled. Digits the detectors held back
+       * still count; entries still open after them can get no more and
+       * are reported before the EOS goes on. */
+      dtmf_timer_cancel (self->stall_timer);
+      g_mutex_lock (&self->entry_lock);
+      flush_detectors (self);
+      GST_OBJECT_LOCK (self);
+      hold = self->rtp_sinkpad && !self->rtp_eos;
+      GST_OBJECT_UNLOCK (self);
+      if (hold)
+        gst_event_replace (&self->held_eos, event);
+      else
+        expire_entries (self);
+      reports = take_reports (self);
+      g_mutex_unlock (&self->entry_lock);
+      emit_reports (self, reports);
+      drain_delay_line (self);
+
+      /* RFC 4733 digits may still come in */
+      if (hold) {
+        GST_DEBUG_OBJECT (self, "Holding EOS until rtp_sink ends");
+        gst_event_unref (event);
+        return TRUE;
+      }
+      break;
+    case GST_EVENT_CUSTOM_DOWNSTREAM:
+    case GST_EVENT_CUSTOM_DOWNSTREAM_OOB:{
+      gchar digit =
+          dtmf_rtp_event_from_structure (gst_event_get_structure (event));
+
+      /* A GstDTMF event counts at the end of the audio before it */
+      if (digit) {
+        g_mutex_lock (&self->entry_lock);
+        process_out_of_band_digit (self, digit, GST_CLOCK_TIME_NONE);
+        update_stall_timer (self);
+        reports = take_reports (self);
+        g_mutex_unlock (&self->entry_lock);
+        emit_reports (self, reports);
+      }
+      break;
+    }
+    default:
+      break;
+  }
 
-  inter_digit_elapsed = g_timer_elapsed (self->inter_digit_timer, NULL) * 1000.0;
-  entry_elapsed = g_timer_elapsed (self->entry_timer, NULL) * 1000.0;
+  return GST_BASE_TRANSFORM_CLASS (gst_dtmf_pin_src_parent_class)->sink_event (trans, event);
+}
 
-  /* Check inter-digit timeout */
-  if (self->pin_position > 0 && inter_digit_elapsed >= self->inter_digit_timeout) {
-    GST_INFO_OBJECT (self,
-        "Inter-digit timeout: %.0fms >= %ums (PIN: '%s')", inter_digit_elapsed,
-        self->inter_digit_timeout, self->pin_buffer);
-    
-    /* Emit timeout message if there's a partial PIN */
-    if (strlen (self->pin_buffer) > 0) {
-      emit_pin_detected_message (self, self->pin_buffer, NULL, FALSE);
+/* Add the suppress mode lookahead to the upstream latency */
+static gboolean
+gst_dtmf_pin_src_query (GstBaseTransform * trans, GstPadDirection direction,
+    GstQuery * query)
+{
+  GstDtmfPinSrc *self = GST_DTMF_PIN_SRC (trans);
+  GstClockTime min, max, delay;
+  gboolean live;
+
+  if (!GST_BASE_TRANSFORM_CLASS (gst_dtmf_pin_src_parent_class)->query (trans,
+          direction, query))
+    return FALSE;
+
+  if (direction == GST_PAD_SRC && GST_QUERY_TYPE (query) == GST_QUERY_LATENCY
+      && g_atomic_int_get (&self->pass_through) ==
+      GST_DTMF_PIN_SRC_PASS_THROUGH_SUPPRESS) {
+    gst_query_parse_latency (query, &live, &min, &max);
+    delay = self->suppress_delay * GST_MSECOND;
+    min += delay;
+    if (GST_CLOCK_TIME_IS_VALID (max))
+      max += delay;
+    GST_DEBUG_OBJECT (self, "Adding %" GST_TIME_FORMAT " suppress latency",
+        GST_TIME_ARGS (delay));
+    gst_query_set_latency (query, live, min, max);
+  }
+
+  return TRUE;
+}
+
+/* Drop an EOS still waiting for rtp_sink when the element stops */
+static gboolean
+gst_dtmf_pin_src_stop (GstBaseTransform * trans)
+{
+  GstDtmfPinSrc *self = GST_DTMF_PIN_SRC (trans);
+
+  g_mutex_lock (&self->entry_lock);
+  gst_event_replace (&self->held_eos, NULL);
+  self->rtp_eos = FALSE;
+  g_mutex_unlock (&self->entry_lock);
+
+  return TRUE;
+}
+
+/* Take RFC 4733 packets from the rtp_sink pad. Only the first packet of
+ * each event does any work, the repeats are dropped after a look at the
+ * header. */
+static GstFlowReturn
+gst_dtmf_pin_src_rtp_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
+{
+  GstDtmfPinSrc *self = GST_DTMF_PIN_SRC (parent);
+  GstClockTime time = GST_CLOCK_TIME_NONE;
+  GstMapInfo map;
+  GArray *reports;
+  gchar digit;
+
+  if (!gst_buffer_map (buf, &map, GST_MAP_READ)) {
+    gst_buffer_unref (buf);
+    return GST_FLOW_ERROR;
+  }
+  digit = dtmf_rtp_event_parse (&self->rtp_state, map.data, map.size);
+  gst_buffer_unmap (buf, &map);
+
+  if (digit) {
+    if (GST_BUFFER_PTS_IS_VALID (buf))
+      time = gst_segment_to_running_time (&self->rtp_segment,
+          GST_FORMAT_TIME, GST_BUFFER_PTS (buf));
+
+    GST_DEBUG_OBJECT (pad, "Telephone event %c at %" GST_TIME_FORMAT, digit,
+        GST_TIME_ARGS (time));
+
+    g_mutex_lock (&self->entry_lock);
+    process_out_of_band_digit (self, digit, time);
+    update_stall_timer (self);
+    reports = take_reports (self);
+    g_mutex_unlock (&self->entry_lock);
+    emit_reports (self, reports);
+  }
+
+  gst_buffer_unref (buf);
+  return GST_FLOW_OK;
+}
+
+/* Send the audio EOS held back for rtp_sink, now that no more RFC 4733
+ * digits can come. Entries still open are reported first. */
+static void
+release_held_eos (GstDtmfPinSrc * self)
+{
+  GArray *reports;
+  GstEvent *eos;
+
+  g_mutex_lock (&self->entry_lock);
+  eos = self->held_eos;
+  self->held_eos = NULL;
+  if (eos)
+    expire_entries (self);
+  reports = take_reports (self);
+  g_mutex_unlock (&self->entry_lock);
+  emit_reports (self, reports);
+
+  if (eos)
+    gst_pad_push_event (GST_BASE_TRANSFORM_SRC_PAD (self), eos);
+}
+
+/* The events end here, nothing is forwarded. EOS counts towards the EOS
+ * of the element. */
+static gboolean
+gst_dtmf_pin_src_rtp_event (GstPad * pad, GstObject * parent,
+    GstEvent * event)
+{
+  GstDtmfPinSrc *self = GST_DTMF_PIN_SRC (parent);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_SEGMENT:
+      gst_event_copy_segment (event, &self->rtp_segment);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      dtmf_rtp_event_state_reset (&self->rtp_state);
+      gst_segment_init (&self->rtp_segment, GST_FORMAT_TIME);
+      g_mutex_lock (&self->entry_lock);
+      self->rtp_eos = FALSE;
+      g_mutex_unlock (&self->entry_lock);
+      break;
+    case GST_EVENT_EOS:
+      g_mutex_lock (&self->entry_lock);
+      self->rtp_eos = TRUE;
+      g_mutex_unlock (&self->entry_lock);
+      release_held_eos (self);
+      break;
+    default:
+      break;
+  }
+
+  gst_event_unref (event);
+  return TRUE;
+}
+
+/* Answer caps queries from the template rather than the audio pads */
+static gboolean
+gst_dtmf_pin_src_rtp_query (GstPad * pad, GstObject * parent,
+    GstQuery * query)
+{
+  GstCaps *filter, *caps;
+
+  if (GST_QUERY_TYPE (query) != GST_QUERY_CAPS)
+    return gst_pad_query_default (pad, parent, query);
+
+  gst_query_parse_caps (query, &filter);
+  caps = gst_pad_get_pad_template_caps (pad);
+  if (filter) {
+    GstCaps *tmp = gst_caps_intersect_full (filter, caps,
+        GST_CAPS_INTERSECT_FIRST);
+
+    gst_caps_unref (caps);
+    caps = tmp;
+  }
+  gst_query_set_caps_result (query, caps);
+  gst_caps_unref (caps);
+
+  return TRUE;
+}
+
+/* Create the rtp_sink pad, there is only one */
+static GstPad *
+gst_dtmf_pin_src_request_new_pad (GstElement * element,
+    GstPadTemplate * templ, const gchar * name, const GstCaps * caps)
+{
+  GstDtmfPinSrc *self = GST_DTMF_PIN_SRC (element);
+  GstPad *pad;
+
+  GST_OBJECT_LOCK (self);
+  if (self->rtp_sinkpad) {
+    GST_OBJECT_UNLOCK (self);
+    GST_WARNING_OBJECT (self, "rtp_sink pad already exists");
+    return NULL;
+  }
+  pad = gst_pad_new_from_template (templ, "rtp_sink");
+  self->rtp_sinkpad = pad;
+  GST_OBJECT_UNLOCK (self);
+
+  dtmf_rtp_event_state_reset (&self->rtp_state);
+  gst_segment_init (&self->rtp_segment, GST_FORMAT_TIME);
+  g_mutex_lock (&self->entry_lock);
+  self->rtp_eos = FALSE;
+  g_mutex_unlock (&self->entry_lock);
+
+  gst_pad_set_chain_function (pad,
+      GST_DEBUG_FUNCPTR (gst_dtmf_pin_src_rtp_chain));
+  gst_pad_set_event_function (pad,
+      GST_DEBUG_FUNCPTR (gst_dtmf_pin_src_rtp_event));
+  gst_pad_set_query_function (pad,
+      GST_DEBUG_FUNCPTR (gst_dtmf_pin_src_rtp_query));
+
+  gst_pad_set_active (pad, TRUE);
+  gst_element_add_pad (element, pad);
+
+  return pad;
+}
+
+static void
+gst_dtmf_pin_src_release_pad (GstElement * element, GstPad * pad)
+{
+  GstDtmfPinSrc *self = GST_DTMF_PIN_SRC (element);
+
+  GST_OBJECT_LOCK (self);
+  if (pad == self->rtp_sinkpad)
+    self->rtp_sinkpad = NULL;
+  GST_OBJECT_UNLOCK (self);
+
+  gst_pad_set_active (pad, FALSE);
+  gst_element_remove_pad (element, pad);
+
+  /* The audio need not wait for a pad that is gone */
+  release_held_eos (self);
+}
+
+/* Reset PIN entry state */
+static void
+reset_pin_entry (GstDtmfPinSrcChannel * ch)
+{
+  dtmf_pin_entry_reset (&ch->entry);
+  ch->last_digit_time = GST_CLOCK_TIME_NONE;
+  ch->entry_start_time = GST_CLOCK_TIME_NONE;
+}
+
+/* Put an event record on the ring, with entry_lock held. Counted and
+ * dropped when the consumer has fallen behind. */
+static void
+push_event (GstDtmfPinSrc * self, GstDtmfPinSrcEventType type, gint channel,
+    const gchar * pin, gsize pin_len, const gchar * function, gboolean valid,
+    GstClockTime time)
+{
+  GstDtmfPinSrcEvent event;
+
+  event.type = type;
+  event.channel = channel;
+  event.valid = valid;
+  event.timestamp = time;
+  pin_len = MIN (pin_len, sizeof (event.pin) - 1);
+  memcpy (event.pin, pin, pin_len);
+  event.pin[pin_len] = '\0';
+  g_strlcpy (event.function, function ? function : "",
+      sizeof (event.function));
+
+  if (!dtmf_event_ring_push (self->events, &event))
+    GST_LOG_OBJECT (self, "Event ring full, dropped event");
+}
+
+/**
+ * gst_dtmf_pin_src_pop_event:
+ * @self: a #GstDtmfPinSrc with a non-zero event-ring-size
+ * @event: (out): the oldest event
+ *
+ * Take the oldest digit or PIN event off the element's event ring,
+ * without locks or allocations. Only one thread may pop events from an
+ * element, and not while event-ring-size is being changed.
+ *
+ * Returns: %FALSE when no event is waiting
+ */
+gboolean
+gst_dtmf_pin_src_pop_event (GstDtmfPinSrc * self, GstDtmfPinSrcEvent * event)
+{
+  g_return_val_if_fail (GST_IS_DTMF_PIN_SRC (self), FALSE);
+
+  return self->events && dtmf_event_ring_pop (self->events, event);
+}
+
+/**
+ * gst_dtmf_pin_src_get_event_fd:
+ * @self: a #GstDtmfPinSrc with a non-zero event-ring-size
+ *
+ * Get an eventfd that becomes readable when events are added, for the
+ * thread popping events to sleep on. Read it to clear it, then pop events
+ * until none are left.
+ *
+ * Returns: the descriptor, owned by the element, or -1 when the ring is
+ *   disabled or eventfd is not available
+ */
+gint
+gst_dtmf_pin_src_get_event_fd (GstDtmfPinSrc * self)
+{
+  g_return_val_if_fail (GST_IS_DTMF_PIN_SRC (self), -1);
+
+  return self->events ? dtmf_event_ring_get_fd (self->events) : -1;
+}
+
+/* Empty queue for GstDtmfPinSrcReport records */
+static void
+clear_report (gpointer data)
+{
+  GstDtmfPinSrcReport *report = data;
+
+  g_free (report->function);
+}
+
+static GArray *
+new_report_queue (void)
+{
+  GArray *reports = g_array_new (FALSE, FALSE, sizeof (GstDtmfPinSrcReport));
+
+  g_array_set_clear_func (reports, clear_report);
+  return reports;
+}
+
+/* Queue a digit or PIN result for emit_reports(), with entry_lock held.
+ * The event ring gets it right away, it has no handlers to wait for. */
+static void
+queue_report (GstDtmfPinSrc * self, GstDtmfPinSrcEventType type,
+    gint channel, const gchar * pin, gsize pin_len, const gchar * function,
+    gboolean valid, GstClockTime time)
+{
+  GstDtmfPinSrcReport report;
+
+  if (self->events)
+    push_event (self, type, channel, pin, pin_len, function, valid, time);
+
+  report.type = type;
+  report.channel = channel;
+  report.valid = valid;
+  report.timestamp = time;
+  pin_len = MIN (pin_len, sizeof (report.pin) - 1);
+  memcpy (report.pin, pin, pin_len);
+  report.pin[pin_len] = '\0';
+  report.function = g_strdup (function);
+  g_array_append_val (self->reports, report);
+}
+
+/* Report a PIN result decided at running time @time, with entry_lock
+ * held */
+static void
+report_pin (GstDtmfPinSrc * self, gint channel, const gchar * pin,
+    const gchar * function, gboolean valid, GstClockTime time)
+{
+  queue_report (self, GST_DTMF_PIN_SRC_EVENT_PIN, channel, pin, strlen (pin),
+      function, valid, time);
+}
+
+/* Take the reports queued so far, with entry_lock held. Returns NULL when
+ * there are none. */
+static GArray *
+take_reports (GstDtmfPinSrc * self)
+{
+  GArray *reports = self->reports;
+
+  if (reports->len == 0)
+    return NULL;
+
+  self->reports = new_report_queue ();
+  return reports;
+}
+
+/* Signal and post @reports from take_reports() in order, without
+ * entry_lock, then free them. Handlers may set properties or block
+ * without stalling the element's other threads. */
+static void
+emit_reports (GstDtmfPinSrc * self, GArray * reports)
+{
+  guint i;
+
+  if (!reports)
+    return;
+
+  for (i = 0; i < reports->len; i++) {
+    GstDtmfPinSrcReport *r = &g_array_index (reports, GstDtmfPinSrcReport, i);
+
+    if (r->type == GST_DTMF_PIN_SRC_EVENT_PIN) {
+      emit_pin_detected_message (self, r->channel, r->pin, r->function,
+          r->valid, r->timestamp);
+      continue;
     }
-    
-    reset_pin_entry (self);
+
+    g_signal_emit (self, gst_dtmf_pin_src_signals[SIGNAL_DIGIT_DETECTED], 0,
+        r->channel, r->pin[0], (guint64) r->timestamp);
+    if (self->post_digits && self->post_messages)
+      emit_digit_detected_message (self, r->channel, r->pin[0], r->timestamp);
+  }
+
+  g_array_free (reports, TRUE);
+}
+
+/* Emit bus message for a detected digit */
+static void
+emit_digit_detected_message (GstDtmfPinSrc * self, gint channel, gchar digit,
+    GstClockTime time)
+{
+  GstStructure *structure;
+
+  structure = dtmf_message_digit_detected (digit, channel, NULL, time);
+  gst_element_post_message (GST_ELEMENT (self),
+      gst_message_new_element (GST_OBJECT (self), structure));
+  g_atomic_int_inc (&self->messages_posted);
+}
+
+/* Report a PIN result decided at running time @time, through the signal
+ * and unless disabled the bus. Called without entry_lock. */
+static void
+emit_pin_detected_message (GstDtmfPinSrc * self, gint channel,
+    const gchar * pin, const gchar * function, gboolean valid,
+    GstClockTime time)
+{
+  GstStructure *structure;
+  GstMessage *message;
+
+  g_signal_emit (self, gst_dtmf_pin_src_signals[SIGNAL_PIN_DETECTED], 0,
+      channel, pin, function ? function : "", valid, (guint64) time);
+
+  if (!self->post_messages)
+    return;
+
+  structure = dtmf_message_pin_detected (pin, function, valid, channel, NULL,
+      time);
+  message = gst_message_new_element (GST_OBJECT (self), structure);
+  gst_element_post_message (GST_ELEMENT (self), message);
+  g_atomic_int_inc (&self->messages_posted);
+
+  GST_DEBUG_OBJECT (self, "Emitted pin-detected message: pin=%s function=%s valid=%d channel=%d",
+      pin, function ? function : "", valid, channel);
+}
+
+/* Process a single DTMF digit entered at running time @time, with
+ * entry_lock held */
+static void
+process_dtmf_digit (GstDtmfPinSrc * self, gint channel, gchar digit,
+    GstClockTime time)
+{
+  GstDtmfPinSrcChannel *ch = &self->channels[channel];
+  const gchar *function = NULL;
+
+  GST_DEBUG_OBJECT (self, "Processing digit: %c on channel %d (current buffer: '%s')",
+      digit, channel, ch->entry.buffer);
+
+  queue_report (self, GST_DTMF_PIN_SRC_EVENT_DIGIT, channel, &digit, 1, NULL,
+      FALSE, time);
+
+  switch (dtmf_pin_entry_push (&ch->entry, self->pins, digit, &function)) {
+    case DTMF_PIN_MATCH:
+      /* PIN matched - reset buffer */
+      GST_INFO_OBJECT (self, "PIN matched on channel %d: %s -> %s", channel,
+          ch->entry.buffer, function);
+      report_pin (self, channel, ch->entry.buffer, function, TRUE, time);
+      reset_pin_entry (ch);
+      break;
+    case DTMF_PIN_PREFIX:
+      /* Start of at least one PIN - keep accumulating */
+      if (ch->entry.position == 1)
+        ch->entry_start_time = time;
+      ch->last_digit_time = time;
+      break;
+    case DTMF_PIN_DEAD_END:
+      /* No PIN can match any more - report and start over */
+      GST_INFO_OBJECT (self, "No PIN starts with %s on channel %d",
+          ch->entry.buffer, channel);
+      report_pin (self, channel, ch->entry.buffer, NULL, FALSE, time);
+      reset_pin_entry (ch);
+      break;
+  }
+}
+
+/* Whether @digit at running time @time is the second report of a key
+ * press, one from in-band detection and one from an out-of-band event,
+ * which only counts once. A report that is not remains for the other
+ * source to match. Called with entry_lock held. */
+static gboolean
+duplicate_digit (GstDtmfPinSrc * self, gint channel, gchar digit,
+    GstClockTime time, gboolean out_of_band)
+{
+  GstDtmfPinSrcChannel *ch = &self->channels[channel];
+  GstClockTime diff;
+
+  if (self->dedup_window == 0)
+    return FALSE;
+
+  if (ch->dedup_digit == digit && ch->dedup_out_of_band != out_of_band) {
+    diff = time > ch->dedup_time ? time - ch->dedup_time :
+        ch->dedup_time - time;
+    if (diff <= self->dedup_window * GST_MSECOND) {
+      GST_DEBUG_OBJECT (self, "Dropping %s report of %c on channel %d",
+          out_of_band ? "out-of-band" : "in-band", digit, channel);
+      ch->dedup_digit = 0;
+      return TRUE;
+    }
+  }
+
+  ch->dedup_digit = digit;
+  ch->dedup_out_of_band = out_of_band;
+  ch->dedup_time = time;
+  return FALSE;
+}
+
+/* Enter an out-of-band digit on channel 0 at running time @time, or at
+ * the end of the data so far when it has none. On a leg that carries no
+ * audio the events move the stream clock themselves. Called with
+ * entry_lock held. */
+static void
+process_out_of_band_digit (GstDtmfPinSrc * self, gchar digit,
+    GstClockTime time)
+{
+  if (!GST_CLOCK_TIME_IS_VALID (time))
+    time = GST_CLOCK_TIME_IS_VALID (self->running_time) ?
+        self->running_time : 0;
+  else if (self->n_channels == 0 && (!GST_CLOCK_TIME_IS_VALID
+          (self->running_time) || time > self->running_time))
+    self->running_time = time;
+
+  adopt_pending_pins (self);
+  check_channel_timeouts (self, 0, time);
+
+  if (!duplicate_digit (self, 0, digit, time, TRUE))
+    process_dtmf_digit (self, 0, digit, time);
+}
+
+/* Whether @timeout_ms has passed between @since and @now */
+static gboolean
+timed_out (GstClockTime since, GstClockTime now, guint timeout_ms)
+{
+  return GST_CLOCK_TIME_IS_VALID (since) && now >= since
+      && now - since >= timeout_ms * GST_MSECOND;
+}
+
+/* Expire the partial entry of @channel at running time @now */
+static void
+check_channel_timeouts (GstDtmfPinSrc * self, gint channel, GstClockTime now)
+{
+  GstDtmfPinSrcChannel *ch = &self->channels[channel];
+
+  if (ch->entry.position == 0)
+    return;
+
+  /* Check inter-digit timeout */
+  if (timed_out (ch->last_digit_time, now, self->inter_digit_timeout)) {
+    GST_INFO_OBJECT (self, "Inter-digit timeout on channel %d: %"
+        GST_TIME_FORMAT " >= %ums (PIN: '%s')", channel,
+        GST_TIME_ARGS (now - ch->last_digit_time), self->inter_digit_timeout,
+        ch->entry.buffer);
+    report_pin (self, channel, ch->entry.buffer, NULL, FALSE, now);
+    reset_pin_entry (ch);
+    return;
   }
 
   /* Check entry timeout */
-  if (entry_elapsed >= self->entry_timeout) {
-    GST_INFO_OBJECT (self, "Entry timeout: %.0fms >= %ums", entry_elapsed,
-        self->entry_timeout);
-    reset_pin_entry (self);
+  if (timed_out (ch->entry_start_time, now, self->entry_timeout)) {
+    GST_INFO_OBJECT (self, "Entry timeout on channel %d: %" GST_TIME_FORMAT
+        " >= %ums (PIN: '%s')", channel,
+        GST_TIME_ARGS (now - ch->entry_start_time), self->entry_timeout,
+        ch->entry.buffer);
+    report_pin (self, channel, ch->entry.buffer, NULL, FALSE, now);
+    reset_pin_entry (ch);
   }
+}
 
-  return TRUE;
+/* Expire partial entries on all channels at running time @now. Called
+ * from the streaming thread, so no timer or main loop is needed. */
+static void
+check_timeouts (GstDtmfPinSrc * self, GstClockTime now)
+{
+  gint c;
+
+  for (c = 0; c < ENTRY_CHANNELS (self); c++)
+    check_channel_timeouts (self, c, now);
+}
+
+/* Take the digits the detectors still hold back at the end of the stream,
+ * counted as entered at its end. Called with entry_lock held. */
+static void
+flush_detectors (GstDtmfPinSrc * self)
+{
+  GstClockTime now = GST_CLOCK_TIME_IS_VALID (self->running_time) ?
+      self->running_time : 0;
+  gchar digits[DTMF_DETECTOR_MAX_DIGITS];
+  gint c, i, n;
+
+  for (c = 0; c < self->n_channels; c++) {
+    GstDtmfPinSrcChannel *ch = &self->channels[c];
+
+    if (!ch->detector)
+      continue;
+
+    n = dtmf_detector_flush (ch->detector, digits, sizeof (digits));
+    if (n)
+      GST_DEBUG_OBJECT (self, "Got %d DTMF events on channel %d at end of "
+          "stream: %s", n, c, digits);
+
+    for (i = 0; i < n; i++) {
+      if (!duplicate_digit (self, c, digits[i], now, FALSE))
+        process_dtmf_digit (self, c, digits[i], now);
+    }
+  }
 }
 
-/* Start timeout checking */
+/* Report every entry still in progress at the end of the stream, as its
+ * timeout would have. Called with entry_lock held. */
 static void
-start_timeout_checking (GstDtmfPinSrc * self)
+expire_entries (GstDtmfPinSrc * self)
+{
+  GstClockTime now = GST_CLOCK_TIME_IS_VALID (self->running_time) ?
+      self->running_time : 0;
+  gint c;
+
+  for (c = 0; c < ENTRY_CHANNELS (self); c++) {
+    GstDtmfPinSrcChannel *ch = &self->channels[c];
+
+    if (ch->entry.position == 0)
+      continue;
+
+    GST_INFO_OBJECT (self, "End of stream on channel %d with PIN '%s' "
+        "pending", c, ch->entry.buffer);
+    report_pin (self, c, ch->entry.buffer, NULL, FALSE, now);
+    reset_pin_entry (ch);
+  }
+}
+
+/* Running time at which the first pending entry times out, or
+ * GST_CLOCK_TIME_NONE when no entry is in progress */
+static GstClockTime
+next_deadline (GstDtmfPinSrc * self)
 {
-  if (!self->timeout_check_id) {
-    self->timeout_check_id = g_timeout_add (100,
-        (GSourceFunc) check_timeouts_continuously, self);
-    GST_DEBUG_OBJECT (self, "Started continuous timeout checking");
+  GstClockTime deadline = GST_CLOCK_TIME_NONE;
+  gint c;
+
+  for (c = 0; c < ENTRY_CHANNELS (self); c++) {
+    GstDtmfPinSrcChannel *ch = &self->channels[c];
+    GstClockTime t;
+
+    if (ch->entry.position == 0)
+      continue;
+
+    t = MIN (ch->last_digit_time + self->inter_digit_timeout * GST_MSECOND,
+        ch->entry_start_time + self->entry_timeout * GST_MSECOND);
+    deadline = MIN (deadline, t);
   }
+
+  return deadline;
 }
 
-/* Stop timeout checking */
+/* Monotonic time at which the stream counts as stalled with @deadline
+ * still pending: no data for the rest of the timeout plus a grace period
+ * for the latency of live sources. */
+static gint64
+stall_time (GstDtmfPinSrc * self, GstClockTime deadline)
+{
+  GstClockTime running_time = GST_CLOCK_TIME_IS_VALID (self->running_time) ?
+      self->running_time : 0;
+  GstClockTime remaining = deadline > running_time ?
+      deadline - running_time : 0;
+
+  return self->last_data_time + remaining / GST_USECOND + STALL_GRACE;
+}
+
+/* Keep the stall timer scheduled while an entry is in progress. Called
+ * with entry_lock held after every buffer and gap; the timer is only
+ * touched when an entry starts or ends, later deadlines are picked up
+ * when it fires. */
 static void
-stop_timeout_checking (GstDtmfPinSrc * self)
+update_stall_timer (GstDtmfPinSrc * self)
 {
-  if (self->timeout_check_id) {
-    g_source_remove (self->timeout_check_id);
-    self->timeout_check_id = 0;
-    GST_DEBUG_OBJECT (self, "Stopped continuous timeout checking");
+  GstClockTime deadline = next_deadline (self);
+
+  if (!GST_CLOCK_TIME_IS_VALID (deadline)) {
+    if (dtmf_timer_is_scheduled (self->stall_timer))
+      dtmf_timer_cancel (self->stall_timer);
+    return;
   }
+
+  self->last_data_time = g_get_monotonic_time ();
+  if (!dtmf_timer_is_scheduled (self->stall_timer))
+    dtmf_timer_schedule (self->stall_timer, stall_time (self, deadline));
+}
+
+/* Shared timer wheel callback. Timeouts normally expire on the streaming
+ * thread as data comes in; this only acts when a playing stream stopped
+ * delivering data with an entry in progress, expiring the entry at its
+ * deadline as if the stream had carried on. @data is a weak reference,
+ * the element may already be on its way out. */
+static void
+stall_timer_expired (gpointer data)
+{
+  GstDtmfPinSrc *self = g_weak_ref_get (data);
+  GstClockTime deadline;
+  GArray *reports;
+  gboolean playing;
+
+  if (!self)
+    return;
+
+  GST_OBJECT_LOCK (self);
+  playing = GST_STATE (self) == GST_STATE_PLAYING;
+  GST_OBJECT_UNLOCK (self);
+
+  /* Picked up again by the next buffer */
+  if (!playing || GST_PAD_IS_EOS (GST_BASE_TRANSFORM_SINK_PAD (self))) {
+    gst_object_unref (self);
+    return;
+  }
+
+  g_mutex_lock (&self->entry_lock);
+
+  deadline = next_deadline (self);
+  while (GST_CLOCK_TIME_IS_VALID (deadline)
+      && stall_time (self, deadline) <= g_get_monotonic_time ()) {
+    GstClockTime expired = deadline;
+
+    GST_INFO_OBJECT (self, "No data since %" GST_TIME_FORMAT
+        ", expiring entries", GST_TIME_ARGS (self->running_time));
+    check_timeouts (self, expired);
+    deadline = next_deadline (self);
+    if (deadline == expired)
+      break;
+  }
+
+  if (GST_CLOCK_TIME_IS_VALID (deadline))
+    dtmf_timer_schedule (self->stall_timer, stall_time (self, deadline));
+
+  reports = take_reports (self);
+  g_mutex_unlock (&self->entry_lock);
+  emit_reports (self, reports);
+  gst_object_unref (self);
 }
 
 /* State reset helper */
 static void
 gst_dtmf_pin_src_state_reset (GstDtmfPinSrc * self)
 {
-  reset_pin_entry (self);
-  if (self->dtmf_state) {
-    dtmf_rx_release (self->dtmf_state);
-    self->dtmf_state = dtmf_rx_init (NULL, NULL, NULL);
+  gint c;
+
+  for (c = 0; c < ENTRY_CHANNELS (self); c++) {
+    GstDtmfPinSrcChannel *ch = &self->channels[c];
+
+    reset_pin_entry (ch);
+    ch->dedup_digit = 0;
+    if (ch->detector)
+      dtmf_detector_reset (ch->detector);
+    if (ch->decimator)
+      dtmf_decimator_reset (ch->decimator);
   }
+  self->analysis_offset = 0;
+  self->delay_fill = 0;
+  g_array_set_size (self->pending_digits, 0);
+  GST_DEBUG_OBJECT (self, "PIN entry reset");
 }
 
 /* Plugin initialization */
@@ -644,8 +2563,15 @@ plugin_init (GstPlugin * plugin)
   GST_INFO ("DTMFPINSRC Plugin - Built on %s at %s", BUILD_DATE, BUILD_TIME);
 #endif
 
-  return gst_element_register (plugin, "dtmfpinsrc", GST_RANK_NONE,
-      GST_TYPE_DTMF_PIN_SRC);
+  GST_DEBUG_CATEGORY_INIT (dtmf_pin_src_debug, "dtmfpinsrc", 0,
+      "DTMF PIN detection");
+
+  if (!gst_element_register (plugin, "dtmfpinsrc", GST_RANK_NONE,
+          GST_TYPE_DTMF_PIN_SRC))
+    return FALSE;
+
+  return gst_element_register (plugin, "dtmfpinmux", GST_RANK_NONE,
+      GST_TYPE_DTMF_PIN_MUX);
 }
 
 GST_PLUGIN_DEFINE (GST_VERSION_MAJOR,
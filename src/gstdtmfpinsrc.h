@@ -26,8 +26,14 @@
 #include <gst/gst.h>
 #include <gst/base/gstbasetransform.h>
 #include <gst/audio/audio.h>
+#include <gio/gio.h>
 
-#include <spandsp.h>
+#include "dtmfdecimator.h"
+#include "dtmfdetector.h"
+#include "dtmfpin.h"
+#include "dtmftimerwheel.h"
+#include "dtmfeventring.h"
+#include "dtmfrtpevent.h"
 
 G_BEGIN_DECLS
 
@@ -47,42 +53,193 @@ G_BEGIN_DECLS
 typedef struct _GstDtmfPinSrc GstDtmfPinSrc;
 typedef struct _GstDtmfPinSrcClass GstDtmfPinSrcClass;
 
-#define MAX_PIN_LENGTH 16
-#define MAX_PINS 100
-#define PIN_BUFFER_SIZE 64
+/* Channels with their own detector and PIN entry state */
+#define DTMF_PIN_SRC_MAX_CHANNELS 8
 
+/* Analysis tick, 20ms at 8 kHz. Digits and timeouts are resolved to tick
+ * boundaries counted from the start of the stream. */
+#define DTMF_PIN_SRC_TICK_SAMPLES 160
+
+/* Longest lookahead of the suppress mode delay line, in ms */
+#define DTMF_PIN_SRC_MAX_SUPPRESS_DELAY 40
+
+/* What happens to the input audio. Values match the boolean property
+ * this replaced. */
+typedef enum {
+  GST_DTMF_PIN_SRC_PASS_THROUGH_FALSE,
+  GST_DTMF_PIN_SRC_PASS_THROUGH_TRUE,
+  GST_DTMF_PIN_SRC_PASS_THROUGH_SUPPRESS,
+} GstDtmfPinSrcPassThrough;
+
+/* What a muted element outputs in place of the input audio */
+typedef enum {
+  GST_DTMF_PIN_SRC_SILENCE_ZERO,
+  GST_DTMF_PIN_SRC_SILENCE_GAP,
+  GST_DTMF_PIN_SRC_SILENCE_DROP,
+} GstDtmfPinSrcSilenceMode;
+
+/* Space for function names in event records, longer names are cut */
+#define DTMF_PIN_SRC_EVENT_FUNCTION_SIZE 48
+
+typedef enum {
+  GST_DTMF_PIN_SRC_EVENT_DIGIT,
+  GST_DTMF_PIN_SRC_EVENT_PIN,
+} GstDtmfPinSrcEventType;
+
+/* Event record returned by gst_dtmf_pin_src_pop_event(). A digit event
+ * holds the digit in pin. */
+typedef struct {
+  GstDtmfPinSrcEventType type;
+  gint channel;
+  gboolean valid;
+  GstClockTime timestamp;
+  gchar pin[MAX_PIN_LENGTH + 2];        /* a dead end is one digit longer */
+  gchar function[DTMF_PIN_SRC_EVENT_FUNCTION_SIZE];
+} GstDtmfPinSrcEvent;
+
+/* Digit recognised in a buffer, waiting for the next output buffer to be
+ * attached to as a GstDtmfDigitMeta */
 typedef struct {
-  gchar pin[MAX_PIN_LENGTH + 1];
-  gchar function[256];
-} PinEntry;
+  gchar digit;
+  gint channel;
+  guint64 start;
+  guint64 end;
+  GstClockTime time;
+} GstDtmfPinSrcDigit;
+
+/* Digit or PIN result decided under entry_lock, signalled and posted
+ * once the lock is released. function is owned by the record, as the
+ * PIN table it came from may be replaced meanwhile. */
+typedef struct {
+  GstDtmfPinSrcEventType type;
+  gint channel;
+  gboolean valid;
+  GstClockTime timestamp;
+  gchar pin[MAX_PIN_LENGTH + 2];
+  gchar *function;
+} GstDtmfPinSrcReport;
+
+/* Detection and PIN entry state of one input channel */
+typedef struct {
+  DtmfDetector *detector;
+  DtmfDecimator *decimator;     /* NULL when the input is already 8 kHz */
+  gint params_cookie;           /* params_cookie the detector was tuned to */
+
+  /* PIN entry state */
+  DtmfPinEntry entry;
+
+  /* Running time of the last digit and of the first digit of the entry */
+  GstClockTime last_digit_time;
+  GstClockTime entry_start_time;
+
+  /* Last digit entered, for the other of in-band detection and
+   * out-of-band events to match its report of the same key press to */
+  gchar dedup_digit;
+  gboolean dedup_out_of_band;
+  GstClockTime dedup_time;
+} GstDtmfPinSrcChannel;
 
 struct _GstDtmfPinSrc
 {
   GstBaseTransform parent;
 
-  /* DTMF detection state */
-  dtmf_rx_state_t *dtmf_state;
+  /* DTMF detection state, one entry per input channel */
+  GstDtmfPinSrcChannel channels[DTMF_PIN_SRC_MAX_CHANNELS];
+  gint n_channels;
+  gint detector_engine;         /* DtmfDetectorEngine, read by streaming thread */
+  gint energy_gate;             /* gboolean, read by streaming thread */
 
-  /* PIN configuration */
-  PinEntry pins[MAX_PINS];
-  gint pin_count;
-  gchar *config_file;
+  /* Detector tuning under the object lock. params_cookie is bumped on
+   * every change for the streaming thread to notice without the lock. */
+  DtmfDetectorParams detector_params;
+  gint params_cookie;
 
-  /* PIN entry state */
-  gchar pin_buffer[PIN_BUFFER_SIZE];
-  gint pin_position;
+  /* Energy gate statistics, under the object lock */
+  guint64 samples_analysed;
+  guint64 samples_skipped;
+
+  /* Input format and 8 kHz analysis path. G.711 input is described as U8
+   * in info, with g711 pointing at its expansion table. */
+  GstAudioInfo info;
+  const gint16 *g711;
+  guint8 silence;               /* byte value of silence in the input */
+  gint16 *planar;               /* deinterleaved 8 kHz input */
+  gsize planar_size;
+  gint16 *analysis;
+  gsize analysis_size;
+  guint64 analysis_offset;      /* 8 kHz samples analysed since the reset */
+
+  /* PIN configuration. pins belongs to the streaming thread, a reloaded
+   * table waits in pending_pins until the next buffer picks it up.
+   * config_file is under the object lock. */
+  DtmfPinTable *pins;
+  DtmfPinTable *pending_pins;
+  gchar *config_file;
+  gboolean auto_reload;
+  GFileMonitor *monitor;
 
-  /* Timeout handling */
-  GTimer *inter_digit_timer;
-  GTimer *entry_timer;
-  GTimer *last_digit_timer;  /* Track timing of last DTMF digit */
+  /* Timeout handling, in running time of the input stream */
   guint inter_digit_timeout;
   guint entry_timeout;
-  guint timeout_check_id;
-  gdouble last_digit_interval;  /* Time since last digit (ms) */
+  GstClockTime running_time;    /* end of the last buffer or gap */
+
+  /* Entry state is shared with the stall timer on the timer wheel thread.
+   * last_data_time is the monotonic time of the last buffer or gap seen
+   * with an entry in progress. The timer holds a weak reference to the
+   * element, so a callback never acts on an element being disposed. */
+  GMutex entry_lock;
+  DtmfTimer *stall_timer;
+  GWeakRef *stall_ref;
+  gint64 last_data_time;
 
   /* Audio pass-through control */
-  gboolean pass_through;
+  gint pass_through;            /* GstDtmfPinSrcPassThrough */
+  gint silence_mode;            /* GstDtmfPinSrcSilenceMode when muted */
+
+  /* Suppress mode delay line of interleaved input frames, oldest first.
+   * Tones are muted in the line and in the buffer behind it before the
+   * audio leaves the element. delay_end is the end time of the last
+   * buffer that went in. */
+  guint suppress_delay;
+  guint8 *delay_line;
+  guint8 *delay_scratch;
+  gsize delay_frames;
+  gsize delay_fill;
+  GstClockTime delay_end;
+
+  /* Post a digit-detected message for every digit */
+  gboolean post_digits;
+
+  /* Post bus messages at all; the signals are always emitted */
+  gboolean post_messages;
+  guint messages_posted;        /* atomic */
+
+  /* Events for gst_dtmf_pin_src_pop_event(), NULL when disabled. Written
+   * with entry_lock held, so the streaming and the timer thread count as
+   * one producer. */
+  DtmfEventRing *events;
+  guint event_ring_size;
+
+  /* GstDtmfPinSrcReport, under entry_lock. Whoever releases the lock
+   * takes the reports and emits them, so handlers never run with it
+   * held. */
+  GArray *reports;
+
+  /* GstDtmfPinSrcDigit, streaming thread only */
+  GArray *pending_digits;
+
+  /* Out-of-band digits. RFC 4733 packets come in on the rtp_sink request
+   * pad, whose streaming thread alone uses rtp_state and rtp_segment.
+   * Its digits go to channel 0 under entry_lock, like GstDTMF events on
+   * the sink pad. The element only ends once both inputs have: an audio
+   * EOS that comes first is kept in held_eos until rtp_sink ends or goes
+   * away. rtp_eos and held_eos are under entry_lock. */
+  GstPad *rtp_sinkpad;
+  DtmfRtpEventState rtp_state;
+  GstSegment rtp_segment;
+  gboolean rtp_eos;
+  GstEvent *held_eos;
+  guint dedup_window;
 };
 
 struct _GstDtmfPinSrcClass
@@ -92,6 +249,22 @@ struct _GstDtmfPinSrcClass
 
 GType gst_dtmf_pin_src_get_type (void);
 
+gboolean gst_dtmf_pin_src_pop_event (GstDtmfPinSrc * self,
+    GstDtmfPinSrcEvent * event);
+gint gst_dtmf_pin_src_get_event_fd (GstDtmfPinSrc * self);
+
+/* Detection engine enum, shared with dtmfpinmux */
+#define GST_TYPE_DTMF_PIN_SRC_DETECTOR (gst_dtmf_pin_src_detector_get_type ())
+GType gst_dtmf_pin_src_detector_get_type (void);
+
+#define GST_TYPE_DTMF_PIN_SRC_PASS_THROUGH \
+  (gst_dtmf_pin_src_pass_through_get_type ())
+GType gst_dtmf_pin_src_pass_through_get_type (void);
+
+#define GST_TYPE_DTMF_PIN_SRC_SILENCE_MODE \
+  (gst_dtmf_pin_src_silence_mode_get_type ())
+GType gst_dtmf_pin_src_silence_mode_get_type (void);
+
 GST_ELEMENT_REGISTER_DECLARE (dtmfpinsrc);
 
 G_END_DECLS
@@ -0,0 +1,268 @@
+/*
+ * DTMF Detector Benchmark
+ *
+ * Runs every detection engine over a WAV file, checks that they report the
+ * same digits and prints the throughput of each in samples per second.
+ * A second pass feeds many streams at once to show how the engines scale
+ * with the channel count. A third runs each engine behind the energy gate,
+ * over the file and over a long idle channel, and reports how much of the
+ * input the gate skipped and how much time that saved.
+ */
+
+#include <glib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "../src/dtmfdecimator.h"
+#include "../src/dtmfdetector.h"
+#include "../src/dtmfgoertzel.h"
+#include "../src/dtmfbatch.h"
+
+/* Buffer size fed to the detectors, 20ms at 8 kHz like a typical pipeline */
+#define CHUNK_SAMPLES 160
+
+/* Concurrent streams for the multi-stream pass */
+#define N_STREAMS 64
+
+/* Length of the synthetic idle channel, in seconds */
+#define IDLE_SECONDS 600
+
+typedef struct {
+  const gchar *name;
+  DtmfDetectorEngine engine;
+} EngineInfo;
+
+static const EngineInfo engines[] = {
+  {"spandsp", DTMF_DETECTOR_ENGINE_SPANDSP},
+  {"goertzel", DTMF_DETECTOR_ENGINE_GOERTZEL},
+  {"goertzel-batch", DTMF_DETECTOR_ENGINE_BATCH},
+};
+
+/* Load a mono S16LE WAV file, decimating to 8 kHz if needed */
+static gint16 *
+load_wav (const gchar * filename, gsize * n_samples)
+{
+  gchar *contents;
+  gsize length, pos = 12;
+  gint rate = 0, channels = 0, bits = 0;
+  gint16 *samples = NULL;
+
+  if (!g_file_get_contents (filename, &contents, &length, NULL))
+    return NULL;
+
+  if (length < 12 || memcmp (contents, "RIFF", 4) || memcmp (contents + 8,
+          "WAVE", 4)) {
+    g_free (contents);
+    return NULL;
+  }
+
+  while (pos + 8 <= length) {
+    guint32 chunk_size = GUINT32_FROM_LE (*(guint32 *) (contents + pos + 4));
+    const gchar *chunk = contents + pos + 8;
+
+    if (pos + 8 + chunk_size > length)
+      chunk_size = length - pos - 8;
+
+    if (!memcmp (contents + pos, "fmt ", 4) && chunk_size >= 16) {
+      channels = GUINT16_FROM_LE (*(guint16 *) (chunk + 2));
+      rate = GUINT32_FROM_LE (*(guint32 *) (chunk + 4));
+      bits = GUINT16_FROM_LE (*(guint16 *) (chunk + 14));
+    } else if (!memcmp (contents + pos, "data", 4) && bits == 16
+        && channels == 1) {
+      gsize n = chunk_size / 2;
+
+      if (rate == DTMF_ANALYSIS_RATE) {
+        samples = g_new (gint16, n);
+        memcpy (samples, chunk, n * 2);
+        *n_samples = n;
+      } else if (rate > DTMF_ANALYSIS_RATE) {
+        DtmfDecimator *dec = dtmf_decimator_new (rate);
+
+        samples = g_new (gint16, dtmf_decimator_max_output (dec, n));
+        *n_samples = dtmf_decimator_process (dec, (const gint16 *) chunk, n,
+            1, samples);
+        dtmf_decimator_free (dec);
+      }
+      break;
+    }
+
+    pos += 8 + chunk_size + (chunk_size & 1);
+  }
+
+  g_free (contents);
+  return samples;
+}
+
+static gchar *
+run_engine (DtmfDetectorEngine engine, const gint16 * samples, gsize n,
+    gboolean gate, guint64 * skipped)
+{
+  DtmfDetector *det = dtmf_detector_new (engine);
+  GString *result = g_string_new (NULL);
+  gchar digits[DTMF_DETECTOR_MAX_DIGITS];
+  gsize pos;
+
+  dtmf_detector_set_gate (det, gate);
+  for (pos = 0; pos < n; pos += CHUNK_SAMPLES) {
+    gsize chunk = MIN (CHUNK_SAMPLES, n - pos);
+
+    if (dtmf_detector_process (det, samples + pos, chunk, digits,
+            DTMF_DETECTOR_MAX_DIGITS) > 0)
+      g_string_append (result, digits);
+  }
+
+  if (skipped)
+    *skipped = dtmf_detector_get_skipped (det);
+  dtmf_detector_free (det);
+  return g_string_free (result, FALSE);
+}
+
+/* Samples per second of one engine, repeated for at least a second */
+static gdouble
+time_engine (DtmfDetectorEngine engine, const gint16 * samples, gsize n,
+    gboolean gate)
+{
+  GTimer *timer = g_timer_new ();
+  guint iterations = 0;
+  gdouble elapsed;
+
+  do {
+    g_free (run_engine (engine, samples, n, gate, NULL));
+    iterations++;
+    elapsed = g_timer_elapsed (timer, NULL);
+  } while (elapsed < 1.0);
+
+  g_timer_destroy (timer);
+  return iterations * n / elapsed;
+}
+
+/* Background noise around -60 dBFS, as on an open channel nobody talks on */
+static gint16 *
+make_idle_channel (gsize n)
+{
+  gint16 *samples = g_new (gint16, n);
+  GRand *rand = g_rand_new_with_seed (4733);
+  gsize i;
+
+  for (i = 0; i < n; i++)
+    samples[i] = g_rand_int_range (rand, -56, 57);
+
+  g_rand_free (rand);
+  return samples;
+}
+
+/* Feed N_STREAMS detectors round-robin, one buffer each per turn.
+ * Returns the aggregate throughput in samples per second. */
+static gdouble
+run_streams (DtmfDetectorEngine engine, const gint16 * samples, gsize n)
+{
+  DtmfDetector *det[N_STREAMS];
+  gchar digits[DTMF_DETECTOR_MAX_DIGITS];
+  GTimer *timer;
+  gdouble elapsed;
+  gsize pos;
+  gint i;
+
+  for (i = 0; i < N_STREAMS; i++)
+    det[i] = dtmf_detector_new (engine);
+
+  timer = g_timer_new ();
+  for (pos = 0; pos < n; pos += CHUNK_SAMPLES) {
+    gsize chunk = MIN (CHUNK_SAMPLES, n - pos);
+
+    for (i = 0; i < N_STREAMS; i++)
+      dtmf_detector_process (det[i], samples + pos, chunk, digits,
+          DTMF_DETECTOR_MAX_DIGITS);
+  }
+  elapsed = g_timer_elapsed (timer, NULL);
+  g_timer_destroy (timer);
+
+  for (i = 0; i < N_STREAMS; i++)
+    dtmf_detector_free (det[i]);
+
+  return N_STREAMS * n / elapsed;
+}
+
+int
+main (int argc, char *argv[])
+{
+  gint16 *samples, *idle;
+  gsize n_samples = 0, n_idle = IDLE_SECONDS * DTMF_ANALYSIS_RATE;
+  gchar *reference = NULL;
+  gboolean match = TRUE;
+  guint e;
+
+  if (argc != 2) {
+    g_printerr ("Usage: %s <audio_file.wav>\n", argv[0]);
+    return -1;
+  }
+
+  samples = load_wav (argv[1], &n_samples);
+  if (!samples) {
+    g_printerr ("Could not load %s (mono 16-bit PCM WAV required)\n",
+        argv[1]);
+    return -1;
+  }
+
+  g_print ("File: %s (%" G_GSIZE_FORMAT " samples at 8000 Hz, %.1fs)\n",
+      argv[1], n_samples, n_samples / 8000.0);
+  g_print ("Goertzel kernel: %s, batch kernel: %s (%d lanes)\n\n",
+      dtmf_goertzel_kernel_name (), dtmf_batch_kernel_name (),
+      DTMF_BATCH_LANES);
+
+  for (e = 0; e < G_N_ELEMENTS (engines); e++) {
+    gchar *digits = run_engine (engines[e].engine, samples, n_samples, FALSE,
+        NULL);
+    gdouble rate = time_engine (engines[e].engine, samples, n_samples, FALSE);
+
+    g_print ("%-15s %12.0f samples/sec  %8.1fx realtime  digits: %s\n",
+        engines[e].name, rate, rate / 8000.0, digits);
+
+    if (!reference)
+      reference = g_strdup (digits);
+    else if (strcmp (reference, digits) != 0)
+      match = FALSE;
+
+    g_free (digits);
+  }
+
+  g_print ("\nDigit sequences %s\n", match ? "MATCH" : "DIFFER");
+
+  g_print ("\n%d concurrent streams, %d sample buffers:\n", N_STREAMS,
+      CHUNK_SAMPLES);
+  for (e = 0; e < G_N_ELEMENTS (engines); e++) {
+    g_print ("%-15s %12.0f samples/sec\n", engines[e].name,
+        run_streams (engines[e].engine, samples, n_samples));
+  }
+
+  /* The gate must not change the digits */
+  idle = make_idle_channel (n_idle);
+  g_print ("\nEnergy gate, on the file and on %ds of idle channel:\n",
+      IDLE_SECONDS);
+  for (e = 0; e < G_N_ELEMENTS (engines); e++) {
+    guint64 skipped = 0, idle_skipped = 0;
+    gchar *digits = run_engine (engines[e].engine, samples, n_samples, TRUE,
+        &skipped);
+    gdouble off, on;
+
+    g_free (run_engine (engines[e].engine, idle, n_idle, TRUE,
+            &idle_skipped));
+    off = time_engine (engines[e].engine, idle, n_idle, FALSE);
+    on = time_engine (engines[e].engine, idle, n_idle, TRUE);
+
+    g_print ("%-15s file %5.1f%% skipped, digits %s  idle %5.1f%% skipped, "
+        "%6.1fx faster, %5.1f%% CPU saved\n", engines[e].name,
+        100.0 * skipped / n_samples,
+        strcmp (reference, digits) == 0 ? "match" : "DIFFER",
+        100.0 * idle_skipped / n_idle, on / off, 100.0 * (1.0 - off / on));
+
+    if (strcmp (reference, digits) != 0)
+      match = FALSE;
+    g_free (digits);
+  }
+
+  g_free (idle);
+  g_free (reference);
+  g_free (samples);
+  return match ? 0 : 1;
+}
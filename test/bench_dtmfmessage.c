@@ -0,0 +1,131 @@
+/*
+ * DTMF Bus Message Benchmark
+ *
+ * Builds pin-detected and digit-detected messages the way the elements
+ * do, with interned field names and referenced strings, and the way they
+ * used to, with gst_structure_new() and string field names. Reports time
+ * and heap allocations per message. Allocations are counted by wrapping
+ * the glibc allocator, so the figures cover GLib and GStreamer as well.
+ */
+
+#include <gst/gst.h>
+#include <stdio.h>
+
+#include "../src/dtmfmessage.h"
+
+#define N_MESSAGES 1000000
+
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t n, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+extern void *__libc_memalign (size_t align, size_t size);
+
+static gint allocations = 0;
+
+void *
+malloc (size_t size)
+{
+  g_atomic_int_inc (&allocations);
+  return __libc_malloc (size);
+}
+
+void *
+calloc (size_t n, size_t size)
+{
+  g_atomic_int_inc (&allocations);
+  return __libc_calloc (n, size);
+}
+
+void *
+realloc (void *ptr, size_t size)
+{
+  g_atomic_int_inc (&allocations);
+  return __libc_realloc (ptr, size);
+}
+
+int
+posix_memalign (void **ptr, size_t align, size_t size)
+{
+  g_atomic_int_inc (&allocations);
+  *ptr = __libc_memalign (align, size);
+  return *ptr ? 0 : 12;
+}
+
+/* pin-detected as built before field names were interned */
+static GstMessage *
+pin_by_name (const gchar * function, guint64 i)
+{
+  return gst_message_new_element (NULL, gst_structure_new ("pin-detected",
+          "pin", G_TYPE_STRING, "1234", "function", G_TYPE_STRING, function,
+          "valid", G_TYPE_BOOLEAN, TRUE, "channel", G_TYPE_INT, 0,
+          "timestamp", G_TYPE_UINT64, i, NULL));
+}
+
+static GstMessage *
+pin_by_quark (const gchar * function, guint64 i)
+{
+  return gst_message_new_element (NULL,
+      dtmf_message_pin_detected ("1234", function, TRUE, 0, NULL, i));
+}
+
+/* digit-detected as built before */
+static GstMessage *
+digit_by_name (const gchar * function, guint64 i)
+{
+  gchar str[2] = { '4', '\0' };
+
+  return gst_message_new_element (NULL, gst_structure_new ("digit-detected",
+          "digit", G_TYPE_STRING, str, "channel", G_TYPE_INT, 0,
+          "timestamp", G_TYPE_UINT64, i, NULL));
+}
+
+static GstMessage *
+digit_by_quark (const gchar * function, guint64 i)
+{
+  return gst_message_new_element (NULL,
+      dtmf_message_digit_detected ('4', 0, NULL, i));
+}
+
+static void
+run (const gchar * name, GstMessage * (*build) (const gchar *, guint64),
+    const gchar * function)
+{
+  GTimer *timer = g_timer_new ();
+  gint start;
+  guint64 i;
+
+  start = g_atomic_int_get (&allocations);
+  g_timer_start (timer);
+  for (i = 0; i < N_MESSAGES; i++)
+    gst_message_unref (build (function, i));
+  g_timer_stop (timer);
+
+  g_print ("%-26s %8.1f ns/message %6.2f allocations/message\n", name,
+      g_timer_elapsed (timer, NULL) * 1e9 / N_MESSAGES,
+      (g_atomic_int_get (&allocations) - start) / (gdouble) N_MESSAGES);
+  g_timer_destroy (timer);
+}
+
+int
+main (int argc, char *argv[])
+{
+  const gchar *function;
+
+  gst_init (&argc, &argv);
+  dtmf_message_init ();
+
+  /* As returned by the PIN table */
+  function = g_intern_string ("open_door");
+
+  /* Warm up type and quark registration */
+  gst_message_unref (pin_by_name (function, 0));
+  gst_message_unref (digit_by_name (function, 0));
+
+  g_print ("%u messages each\n\n", N_MESSAGES);
+  run ("pin-detected, by name", pin_by_name, function);
+  run ("pin-detected, interned", pin_by_quark, function);
+  run ("digit-detected, by name", digit_by_name, function);
+  run ("digit-detected, interned", digit_by_quark, function);
+
+  return 0;
+}
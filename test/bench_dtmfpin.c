@@ -0,0 +1,193 @@
+/*
+ * DTMF PIN Table Benchmark
+ *
+ * Generates PIN databases of 1k, 100k and 1M entries, then measures how
+ * long dtmf_pin_table_new_from_file takes to load and compile each one and
+ * how long a lookup takes, both as a whole PIN and one digit at a time as
+ * the elements do. Each database is also saved as a compiled .pinx file to
+ * compare its mapped load time with parsing the text.
+ */
+
+#include <gst/gst.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "../src/dtmfpin.h"
+
+GST_DEBUG_CATEGORY (dtmf_pin_src_debug);
+
+/* Lookups timed per database, half of them hits */
+#define N_QUERIES 1000000
+
+/* Distinct function names, so the interned pool stays small */
+#define N_FUNCTIONS 64
+
+static const gchar digits[] = "0123456789*#ABCD";
+
+static void
+random_pin (GRand * rand, gchar * pin)
+{
+  gint len = g_rand_int_range (rand, 6, 11);
+  gint i;
+
+  /* Mostly numeric, like provisioned access codes */
+  for (i = 0; i < len; i++)
+    pin[i] = digits[g_rand_int_range (rand, 0,
+            g_rand_int_range (rand, 0, 8) ? 10 : 16)];
+  pin[len] = '\0';
+}
+
+/* Write @n random PINs to a temporary file, keeping them in @pins */
+static gchar *
+write_database (GRand * rand, guint n, gchar ** pins)
+{
+  GError *error = NULL;
+  gchar *path;
+  FILE *file;
+  gint fd;
+  guint i;
+
+  fd = g_file_open_tmp ("dtmfpin-XXXXXX.pin", &path, &error);
+  if (fd < 0) {
+    g_printerr ("Could not create database: %s\n", error->message);
+    g_clear_error (&error);
+    return NULL;
+  }
+
+  file = fdopen (fd, "w");
+  fprintf (file, "; %u generated PIN codes\n", n);
+  for (i = 0; i < n; i++) {
+    pins[i] = g_malloc (MAX_PIN_LENGTH + 1);
+    random_pin (rand, pins[i]);
+    fprintf (file, "%s=access_level_%u\n", pins[i], i % N_FUNCTIONS);
+  }
+  fclose (file);
+
+  return path;
+}
+
+/* Average time to load @path, repeated so small databases give a stable
+ * figure. Returns the last table loaded in @table. */
+static gdouble
+time_load (const gchar * path, DtmfPinTable ** table)
+{
+  GTimer *timer = g_timer_new ();
+  guint loads = 0;
+  gdouble elapsed;
+
+  *table = NULL;
+  do {
+    if (*table)
+      dtmf_pin_table_unref (*table);
+    *table = dtmf_pin_table_new_from_file (NULL, path);
+    loads++;
+  } while (g_timer_elapsed (timer, NULL) < 0.5);
+  elapsed = g_timer_elapsed (timer, NULL) / loads;
+
+  g_timer_destroy (timer);
+  return elapsed;
+}
+
+static void
+run_size (GRand * rand, guint n)
+{
+  gchar **pins = g_new0 (gchar *, n);
+  gchar **queries = g_new (gchar *, N_QUERIES);
+  gchar *misses = g_malloc ((N_QUERIES / 2) * (MAX_PIN_LENGTH + 1));
+  DtmfPinTable *table, *mapped;
+  GTimer *timer;
+  gdouble load_time, pinx_time, lookup_time, digit_time;
+  guint hits = 0, n_digits = 0;
+  gchar *path, *pinx_path;
+  guint i;
+
+  path = write_database (rand, n, pins);
+  if (!path) {
+    g_free (pins);
+    g_free (queries);
+    g_free (misses);
+    return;
+  }
+
+  load_time = time_load (path, &table);
+
+  pinx_path = g_strconcat (path, "x", NULL);
+  if (!dtmf_pin_table_save (table, pinx_path, NULL)) {
+    g_printerr ("Could not write %s\n", pinx_path);
+    pinx_time = 0;
+  } else {
+    pinx_time = time_load (pinx_path, &mapped);
+    dtmf_pin_table_unref (mapped);
+    g_unlink (pinx_path);
+  }
+  g_free (pinx_path);
+
+  /* Alternate configured PINs with random, mostly unknown ones */
+  for (i = 0; i < N_QUERIES; i++) {
+    if (i & 1) {
+      queries[i] = pins[g_rand_int_range (rand, 0, n)];
+    } else {
+      queries[i] = misses + (i / 2) * (MAX_PIN_LENGTH + 1);
+      random_pin (rand, queries[i]);
+    }
+  }
+
+  timer = g_timer_new ();
+  for (i = 0; i < N_QUERIES; i++) {
+    if (dtmf_pin_table_lookup (table, queries[i]))
+      hits++;
+  }
+  lookup_time = g_timer_elapsed (timer, NULL);
+
+  g_timer_start (timer);
+  for (i = 0; i < N_QUERIES; i++) {
+    DtmfPinEntry entry;
+    const gchar *function;
+    const gchar *p;
+
+    dtmf_pin_entry_reset (&entry);
+    for (p = queries[i]; *p; p++) {
+      n_digits++;
+      if (dtmf_pin_entry_push (&entry, table, *p, &function) != DTMF_PIN_PREFIX)
+        break;
+    }
+  }
+  digit_time = g_timer_elapsed (timer, NULL);
+
+  g_print ("%8u PINs  %8u nodes  %7.2f MB  load %9.3f ms  pinx %7.3f ms  "
+      "lookup %6.1f ns  digit %5.1f ns  (%u%% hits)\n",
+      dtmf_pin_table_size (table), dtmf_pin_table_n_nodes (table),
+      dtmf_pin_table_memory_size (table) / 1048576.0, load_time * 1000.0,
+      pinx_time * 1000.0, lookup_time * 1e9 / N_QUERIES, digit_time * 1e9 / n_digits,
+      hits * 100 / N_QUERIES);
+
+  dtmf_pin_table_unref (table);
+  g_unlink (path);
+  g_free (path);
+  for (i = 0; i < n; i++)
+    g_free (pins[i]);
+  g_free (pins);
+  g_free (queries);
+  g_free (misses);
+  g_timer_destroy (timer);
+}
+
+int
+main (int argc, char *argv[])
+{
+  static const guint sizes[] = { 1000, 100000, 1000000 };
+  GRand *rand;
+  guint i;
+
+  gst_init (&argc, &argv);
+  GST_DEBUG_CATEGORY_INIT (dtmf_pin_src_debug, "dtmfpinsrc", 0,
+      "DTMF PIN detection");
+
+  rand = g_rand_new_with_seed (4733);
+  for (i = 0; i < G_N_ELEMENTS (sizes); i++)
+    run_size (rand, sizes[i]);
+  g_rand_free (rand);
+
+  return 0;
+}
@@ -0,0 +1,242 @@
+/*
+ * DTMF PIN Element Benchmark
+ *
+ * Runs dtmfpinsrc over a WAV file as fast as the CPU allows, the way a
+ * bulk scan of recordings does:
+ *
+ *   appsrc ! dtmfpinsrc ! fakesink sync=false
+ *
+ * The file is repeated to a few minutes of audio and pushed in buffers of
+ * several sizes. Each run reports its realtime factor, and the PIN results
+ * of all runs must match, since detection and timeouts only depend on the
+ * sample position. Needs the plugin on GST_PLUGIN_PATH.
+ */
+
+#include <gst/gst.h>
+#include <gst/app/gstappsrc.h>
+#include <gst/audio/audio.h>
+#include <string.h>
+#include <stdio.h>
+
+/* Audio pushed per run, the file is repeated up to this length */
+#define MIN_SECONDS 300
+
+/* Buffer sizes to push, in frames */
+static const guint block_frames[] = { 160, 80, 441, 1024, 4096, 32768 };
+
+/* Load a 16-bit PCM WAV file as is */
+static gint16 *
+load_wav (const gchar * filename, gsize * n_frames, gint * rate,
+    gint * channels)
+{
+  gchar *contents;
+  gsize length, pos = 12;
+  gint bits = 0;
+  gint16 *samples = NULL;
+
+  if (!g_file_get_contents (filename, &contents, &length, NULL))
+    return NULL;
+
+  if (length < 12 || memcmp (contents, "RIFF", 4) || memcmp (contents + 8,
+          "WAVE", 4)) {
+    g_free (contents);
+    return NULL;
+  }
+
+  while (pos + 8 <= length) {
+    guint32 chunk_size = GUINT32_FROM_LE (*(guint32 *) (contents + pos + 4));
+    const gchar *chunk = contents + pos + 8;
+
+    if (pos + 8 + chunk_size > length)
+      chunk_size = length - pos - 8;
+
+    if (!memcmp (contents + pos, "fmt ", 4) && chunk_size >= 16) {
+      *channels = GUINT16_FROM_LE (*(guint16 *) (chunk + 2));
+      *rate = GUINT32_FROM_LE (*(guint32 *) (chunk + 4));
+      bits = GUINT16_FROM_LE (*(guint16 *) (chunk + 14));
+    } else if (!memcmp (contents + pos, "data", 4) && bits == 16
+        && *channels > 0) {
+      *n_frames = chunk_size / 2 / *channels;
+      samples = g_memdup2 (chunk, *n_frames * *channels * 2);
+      break;
+    }
+
+    pos += 8 + chunk_size + (chunk_size & 1);
+  }
+
+  g_free (contents);
+  return samples;
+}
+
+/* Run one pipeline, pushing @n_frames of @samples @block frames at a time.
+ * Returns the PIN results, one line per pin-detected message. */
+static gchar *
+run_pipeline (const gint16 * samples, gsize n_frames, GstAudioInfo * info,
+    const gchar * config_file, guint block, gdouble * elapsed)
+{
+  GstElement *pipeline, *src;
+  GString *result = g_string_new (NULL);
+  GstCaps *caps;
+  GstBus *bus;
+  GstMessage *msg;
+  GTimer *timer;
+  gchar *desc;
+  gsize pos;
+  gint bpf = GST_AUDIO_INFO_BPF (info);
+
+  desc = g_strdup_printf ("appsrc name=src format=time block=true "
+      "max-bytes=%u ! dtmfpinsrc config-file=%s ! fakesink sync=false",
+      block * bpf * 16, config_file);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  if (!pipeline)
+    return NULL;
+
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  caps = gst_audio_info_to_caps (info);
+  gst_app_src_set_caps (GST_APP_SRC (src), caps);
+  gst_caps_unref (caps);
+
+  timer = g_timer_new ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  for (pos = 0; pos < n_frames; pos += block) {
+    gsize frames = MIN (block, n_frames - pos);
+    GstBuffer *buf = gst_buffer_new_memdup (samples + pos *
+        GST_AUDIO_INFO_CHANNELS (info), frames * bpf);
+
+    GST_BUFFER_PTS (buf) = gst_util_uint64_scale_int (pos, GST_SECOND,
+        GST_AUDIO_INFO_RATE (info));
+    GST_BUFFER_DURATION (buf) = gst_util_uint64_scale_int (pos + frames,
+        GST_SECOND, GST_AUDIO_INFO_RATE (info)) - GST_BUFFER_PTS (buf);
+    if (gst_app_src_push_buffer (GST_APP_SRC (src), buf) != GST_FLOW_OK)
+      break;
+  }
+  gst_app_src_end_of_stream (GST_APP_SRC (src));
+
+  bus = gst_element_get_bus (pipeline);
+  for (;;) {
+    const GstStructure *s;
+
+    msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+        GST_MESSAGE_ELEMENT | GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+    if (GST_MESSAGE_TYPE (msg) != GST_MESSAGE_ELEMENT)
+      break;
+
+    s = gst_message_get_structure (msg);
+    if (gst_structure_has_name (s, "pin-detected")) {
+      const gchar *pin = gst_structure_get_string (s, "pin");
+      gboolean valid = FALSE;
+      gint channel = 0;
+
+      gst_structure_get_boolean (s, "valid", &valid);
+      gst_structure_get_int (s, "channel", &channel);
+      g_string_append_printf (result, "%d %s %s\n", channel, pin,
+          valid ? "valid" : "invalid");
+    }
+    gst_message_unref (msg);
+  }
+  *elapsed = g_timer_elapsed (timer, NULL);
+
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+    GError *err;
+
+    gst_message_parse_error (msg, &err, NULL);
+    g_printerr ("Error: %s\n", err->message);
+    g_error_free (err);
+    g_string_free (result, TRUE);
+    result = NULL;
+  }
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  g_timer_destroy (timer);
+  gst_object_unref (bus);
+  gst_object_unref (src);
+  gst_object_unref (pipeline);
+
+  return result ? g_string_free (result, FALSE) : NULL;
+}
+
+int
+main (int argc, char *argv[])
+{
+  GstAudioInfo info;
+  gint16 *file_samples, *samples;
+  gsize file_frames = 0, n_frames;
+  gint rate = 0, channels = 0;
+  GstElementFactory *factory;
+  gchar *reference = NULL;
+  gboolean match = TRUE;
+  guint repeat, i;
+
+  gst_init (&argc, &argv);
+
+  if (argc != 3) {
+    g_printerr ("Usage: %s <audio_file.wav> <codes.pin>\n", argv[0]);
+    return -1;
+  }
+
+  factory = gst_element_factory_find ("dtmfpinsrc");
+  if (!factory) {
+    g_printerr ("dtmfpinsrc not found, set GST_PLUGIN_PATH\n");
+    return -1;
+  }
+  gst_object_unref (factory);
+
+  file_samples = load_wav (argv[1], &file_frames, &rate, &channels);
+  if (!file_samples || file_frames == 0 || channels > 2) {
+    g_printerr ("Could not load %s (mono or stereo 16-bit PCM WAV "
+        "required)\n", argv[1]);
+    return -1;
+  }
+
+  /* Repeat the file to get a figure that is not all pipeline setup */
+  repeat = (MIN_SECONDS * (gsize) rate + file_frames - 1) / file_frames;
+  n_frames = file_frames * repeat;
+  samples = g_new (gint16, n_frames * channels);
+  for (i = 0; i < repeat; i++)
+    memcpy (samples + i * file_frames * channels, file_samples,
+        file_frames * channels * sizeof (gint16));
+
+  gst_audio_info_set_format (&info, GST_AUDIO_FORMAT_S16LE, rate, channels,
+      NULL);
+
+  g_print ("File: %s (%d Hz, %d channels, %.1fs), repeated to %.1fs\n\n",
+      argv[1], rate, channels, (gdouble) file_frames / rate,
+      (gdouble) n_frames / rate);
+
+  for (i = 0; i < G_N_ELEMENTS (block_frames); i++) {
+    gdouble elapsed = 0;
+    gchar *pins = run_pipeline (samples, n_frames, &info, argv[2],
+        block_frames[i], &elapsed);
+    guint n_pins = 0;
+    const gchar *p;
+
+    if (!pins) {
+      match = FALSE;
+      break;
+    }
+
+    for (p = pins; *p; p++)
+      n_pins += *p == '\n';
+
+    g_print ("%6u frame buffers %8.2fs %8.1fx realtime  %u PIN results\n",
+        block_frames[i], elapsed, n_frames / (gdouble) rate / elapsed, n_pins);
+
+    if (!reference)
+      reference = pins;
+    else {
+      if (strcmp (reference, pins) != 0)
+        match = FALSE;
+      g_free (pins);
+    }
+  }
+
+  g_print ("\nPIN results %s\n", match ? "MATCH" : "DIFFER");
+
+  g_free (reference);
+  g_free (samples);
+  g_free (file_samples);
+  return match ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+/*
+ * DTMF Energy Gate Test
+ *
+ * Feeds a digit just above each engine's detection threshold, over a quiet
+ * noise floor, with the energy gate off and on. Both runs must report the
+ * digit: the gate may only skip blocks the engine would not have found a
+ * tone in. spandsp detects down to -42 dBm0 by default and gets a -38 dBm0
+ * digit; the goertzel engines stop at -26 dBm0 and get a -22 dBm0 one.
+ */
+
+#include <glib.h>
+#include <math.h>
+#include <stdio.h>
+
+#include "../src/dtmfdetector.h"
+
+#define RATE 8000
+
+/* Buffer size fed to the detectors, 20ms at 8 kHz like a typical pipeline */
+#define CHUNK_SAMPLES 160
+
+/* Digit 5: 770 + 1336 Hz, 100 ms between 300 ms of noise on either side */
+#define DIGIT '5'
+#define LOW_HZ 770.0
+#define HIGH_HZ 1336.0
+#define TONE_MS 100
+#define NOISE_MS 300
+
+typedef struct {
+  const gchar *name;
+  DtmfDetectorEngine engine;
+  gdouble level;                /* dBm0 of each tone */
+} GateCase;
+
+static const GateCase cases[] = {
+  {"spandsp", DTMF_DETECTOR_ENGINE_SPANDSP, -38.0},
+  {"goertzel", DTMF_DETECTOR_ENGINE_GOERTZEL, -22.0},
+  {"goertzel-batch", DTMF_DETECTOR_ENGINE_BATCH, -22.0},
+};
+
+/* Noise around -60 dBFS with the digit at @level dBm0 per tone in the
+ * middle. A full scale sine is +3.14 dBm0. */
+static gint16 *
+make_digit (gdouble level, gsize * n_samples)
+{
+  gsize noise = RATE * NOISE_MS / 1000, tone = RATE * TONE_MS / 1000;
+  gsize n = 2 * noise + tone, i;
+  gdouble amplitude = 32767.0 * pow (10.0, (level - 3.14) / 20.0);
+  gint16 *samples = g_new (gint16, n);
+  GRand *rand = g_rand_new_with_seed (4733);
+
+  for (i = 0; i < n; i++) {
+    gdouble x = g_rand_int_range (rand, -32, 33);
+
+    if (i >= noise && i < noise + tone)
+      x += amplitude * (sin (2 * G_PI * LOW_HZ * i / RATE) +
+          sin (2 * G_PI * HIGH_HZ * i / RATE));
+    samples[i] = (gint16) CLAMP (x, -32768, 32767);
+  }
+
+  g_rand_free (rand);
+  *n_samples = n;
+  return samples;
+}
+
+static gchar *
+run_engine (DtmfDetectorEngine engine, const gint16 * samples, gsize n,
+    gboolean gate)
+{
+  DtmfDetector *det = dtmf_detector_new (engine);
+  GString *result = g_string_new (NULL);
+  gchar digits[DTMF_DETECTOR_MAX_DIGITS];
+  gsize pos;
+
+  dtmf_detector_set_gate (det, gate);
+  for (pos = 0; pos < n; pos += CHUNK_SAMPLES) {
+    gsize chunk = MIN (CHUNK_SAMPLES, n - pos);
+
+    if (dtmf_detector_process (det, samples + pos, chunk, digits,
+            DTMF_DETECTOR_MAX_DIGITS) > 0)
+      g_string_append (result, digits);
+  }
+  if (dtmf_detector_flush (det, digits, DTMF_DETECTOR_MAX_DIGITS) > 0)
+    g_string_append (result, digits);
+
+  dtmf_detector_free (det);
+  return g_string_free (result, FALSE);
+}
+
+int
+main (int argc, char *argv[])
+{
+  gboolean ok = TRUE;
+  guint c;
+
+  for (c = 0; c < G_N_ELEMENTS (cases); c++) {
+    gsize n;
+    gint16 *samples = make_digit (cases[c].level, &n);
+    gchar *plain = run_engine (cases[c].engine, samples, n, FALSE);
+    gchar *gated = run_engine (cases[c].engine, samples, n, TRUE);
+    gboolean pass = plain[0] == DIGIT && !plain[1]
+        && g_strcmp0 (plain, gated) == 0;
+
+    printf ("%-16s %+.0f dBm0  gate off '%s'  gate on '%s'  %s\n",
+        cases[c].name, cases[c].level, plain, gated, pass ? "PASS" : "FAIL");
+
+    ok &= pass;
+    g_free (plain);
+    g_free (gated);
+    g_free (samples);
+  }
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,157 @@
+/*
+ * DTMF PIN End of Stream Test
+ *
+ * Enters the first digits of a configured PIN and ends the stream before
+ * either timeout could run out:
+ *
+ *   appsrc ! dtmfpinsrc ! fakesink
+ *   appsrc ! dtmfpinmux ! fakesink
+ *
+ * The partial entry must still be reported, as an invalid pin-detected
+ * message carrying the digits entered, before the EOS reaches the bus.
+ * Needs the plugin on GST_PLUGIN_PATH.
+ */
+
+#include <gst/gst.h>
+#include <gst/app/gstappsrc.h>
+#include <math.h>
+#include <string.h>
+
+#define RATE 8000
+
+/* Digits entered; 1234 is in codes.pin, so these are a live prefix */
+#define PARTIAL_PIN "12"
+
+/* Tone and pause lengths, in ms */
+#define TONE_MS 100
+#define PAUSE_MS 100
+
+static const struct
+{
+  gchar digit;
+  gdouble low, high;
+} tones[] = {
+  {'1', 697, 1209}, {'2', 697, 1336}, {'3', 697, 1477},
+  {'4', 770, 1209}, {'5', 770, 1336}, {'6', 770, 1477},
+  {'7', 852, 1209}, {'8', 852, 1336}, {'9', 852, 1477},
+  {'0', 941, 1336},
+};
+
+/* 8 kHz mono S16 audio of @digits, each followed by a pause */
+static GstBuffer *
+make_digits (const gchar * digits)
+{
+  gsize tone = RATE * TONE_MS / 1000, pause = RATE * PAUSE_MS / 1000;
+  gsize n = strlen (digits) * (tone + pause) + pause;
+  gint16 *samples = g_new0 (gint16, n);
+  gsize pos = pause, i, k;
+  GstBuffer *buf;
+
+  for (; *digits; digits++) {
+    for (k = 0; k < G_N_ELEMENTS (tones) && tones[k].digit != *digits; k++);
+    g_assert (k < G_N_ELEMENTS (tones));
+
+    for (i = 0; i < tone; i++)
+      samples[pos + i] = 8000 * (sin (2 * G_PI * tones[k].low * i / RATE) +
+          sin (2 * G_PI * tones[k].high * i / RATE));
+    pos += tone + pause;
+  }
+
+  buf = gst_buffer_new_wrapped (samples, n * sizeof (gint16));
+  GST_BUFFER_PTS (buf) = 0;
+  GST_BUFFER_DURATION (buf) = gst_util_uint64_scale_int (n, GST_SECOND, RATE);
+
+  return buf;
+}
+
+/* Run @element over the partial PIN and check what reaches the bus */
+static gboolean
+run_element (const gchar * element, const gchar * config_file)
+{
+  GstElement *pipeline, *src;
+  GstCaps *caps;
+  GstBus *bus;
+  GstMessage *msg;
+  gchar *desc;
+  gboolean reported = FALSE, ok = TRUE;
+
+  desc = g_strdup_printf ("appsrc name=src format=time ! %s "
+      "config-file=%s ! fakesink sync=false", element, config_file);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  if (!pipeline) {
+    g_printerr ("%s: could not create pipeline\n", element);
+    return FALSE;
+  }
+
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  caps = gst_caps_from_string ("audio/x-raw,format=S16LE,rate=8000,"
+      "channels=1,layout=interleaved");
+  gst_app_src_set_caps (GST_APP_SRC (src), caps);
+  gst_caps_unref (caps);
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  gst_app_src_push_buffer (GST_APP_SRC (src), make_digits (PARTIAL_PIN));
+  gst_app_src_end_of_stream (GST_APP_SRC (src));
+
+  bus = gst_element_get_bus (pipeline);
+  for (;;) {
+    const GstStructure *s;
+
+    msg = gst_bus_timed_pop_filtered (bus, 10 * GST_SECOND,
+        GST_MESSAGE_ELEMENT | GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+    if (!msg || GST_MESSAGE_TYPE (msg) != GST_MESSAGE_ELEMENT)
+      break;
+
+    s = gst_message_get_structure (msg);
+    if (gst_structure_has_name (s, "pin-detected")) {
+      const gchar *pin = gst_structure_get_string (s, "pin");
+      gboolean valid = TRUE;
+
+      gst_structure_get_boolean (s, "valid", &valid);
+      if (reported || valid || g_strcmp0 (pin, PARTIAL_PIN) != 0) {
+        g_printerr ("%s: unexpected pin-detected pin=%s valid=%d\n", element,
+            pin, valid);
+        ok = FALSE;
+      }
+      reported = TRUE;
+    }
+    gst_message_unref (msg);
+  }
+
+  if (!msg || GST_MESSAGE_TYPE (msg) != GST_MESSAGE_EOS) {
+    g_printerr ("%s: stream did not end cleanly\n", element);
+    ok = FALSE;
+  } else if (!reported) {
+    g_printerr ("%s: partial PIN lost at end of stream\n", element);
+    ok = FALSE;
+  }
+  if (msg)
+    gst_message_unref (msg);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (src);
+  gst_object_unref (pipeline);
+
+  g_print ("%-12s %s\n", element, ok ? "PASS" : "FAIL");
+  return ok;
+}
+
+int
+main (int argc, char *argv[])
+{
+  gboolean ok;
+
+  gst_init (&argc, &argv);
+
+  if (argc != 2) {
+    g_printerr ("Usage: %s <codes.pin>\n", argv[0]);
+    return -1;
+  }
+
+  ok = run_element ("dtmfpinsrc", argv[1]);
+  ok &= run_element ("dtmfpinmux", argv[1]);
+
+  return ok ? 0 : 1;
+}
@@ -309,7 +309,7 @@ main (int argc, char *argv[])
   g_print ("⚙️  Config file: %s\n", argv[2]);
   g_print ("\n");
   g_print ("🎧 Pass-through: ENABLED (you will hear the audio)\n");
-  g_print ("🔊 Sample rate: 8000 Hz (required for DTMF detection)\n");
+  g_print ("🔊 Sample rate: 8000-48000 Hz (decimated to 8000 Hz for detection)\n");
   g_print ("\n");
   g_print ("────────────────────────────────────────────────────────────────\n");
   g_print ("Press Ctrl+C to stop the test\n");
@@ -0,0 +1,85 @@
+/*
+ * GStreamer - DTMF PIN Source Detection Plugin for the Repeater Project
+ *
+ * Copyright 2025 Robert Hensel VK3DG vk3dg@gmail.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * dtmfpin-compile: compile a codes.pin file into a .pinx index
+ *
+ *   dtmfpin-compile codes.pin codes.pinx
+ *
+ * The .pinx file can be given to the config-file property of dtmfpinsrc
+ * and dtmfpinmux in place of the text file. It is mapped read-only, so
+ * loading it costs nothing and every process using it shares one copy.
+ * Run with GST_DEBUG=dtmfpinsrc:4 to see rejected lines.
+ */
+
+#include <gst/gst.h>
+#include <stdio.h>
+
+#include "../src/dtmfpin.h"
+
+GST_DEBUG_CATEGORY (dtmf_pin_src_debug);
+
+int
+main (int argc, char *argv[])
+{
+  DtmfPinTable *table, *check;
+  GError *error = NULL;
+
+  gst_init (&argc, &argv);
+  GST_DEBUG_CATEGORY_INIT (dtmf_pin_src_debug, "dtmfpinsrc", 0,
+      "DTMF PIN Source");
+
+  if (argc != 3) {
+    g_printerr ("Usage: %s <codes.pin> <codes.pinx>\n", argv[0]);
+    return 1;
+  }
+
+  table = dtmf_pin_table_new_from_file (NULL, argv[1]);
+  if (!table) {
+    g_printerr ("Could not load %s\n", argv[1]);
+    return 1;
+  }
+
+  if (!dtmf_pin_table_save (table, argv[2], &error)) {
+    g_printerr ("Could not write %s: %s\n", argv[2], error->message);
+    g_error_free (error);
+    dtmf_pin_table_unref (table);
+    return 1;
+  }
+
+  /* Read it back the way the elements will */
+  check = dtmf_pin_table_new_from_file (NULL, argv[2]);
+  if (!check || dtmf_pin_table_size (check) != dtmf_pin_table_size (table)) {
+    g_printerr ("Verification of %s failed\n", argv[2]);
+    if (check)
+      dtmf_pin_table_unref (check);
+    dtmf_pin_table_unref (table);
+    return 1;
+  }
+
+  g_print ("%s: %d PINs, %u trie nodes, %" G_GSIZE_FORMAT " bytes\n",
+      argv[2], dtmf_pin_table_size (table), dtmf_pin_table_n_nodes (table),
+      dtmf_pin_table_memory_size (table));
+
+  dtmf_pin_table_unref (check);
+  dtmf_pin_table_unref (table);
+  return 0;
+}
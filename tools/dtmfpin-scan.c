@@ -0,0 +1,420 @@
+/*
+ * GStreamer - DTMF PIN Source Detection Plugin for the Repeater Project
+ *
+ * Copyright 2025 Robert Hensel VK3DG vk3dg@gmail.com
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * dtmfpin-scan: scan recordings for DTMF digits and PINs
+ *
+ *   dtmfpin-scan -c codes.pin /archive/2024 /archive/2025
+ *   find /archive -name '*.flac' | dtmfpin-scan -c codes.pin -l -
+ *
+ * Every file runs through
+ *
+ *   filesrc ! decodebin ! audioconvert ! audioresample !
+ *       dtmfpinsrc post-digits=true ! fakesink sync=false
+ *
+ * as fast as it decodes, one pipeline per core. Files are dealt out to
+ * one queue per worker; a worker that runs out takes files from the back
+ * of the others, so a few long recordings do not leave cores idle at the
+ * end. One JSON object is written per line for every digit and PIN:
+ *
+ *   {"file":"a.wav","channel":0,"offset":12.340,"digit":"1"}
+ *   {"file":"a.wav","channel":0,"offset":13.380,"pin":"1234","valid":true,
+ *    "function":"unlock_front_door"}
+ *
+ * offset is the position in the file in seconds. The lines of one file are
+ * written together. The audio time scanned per wall-clock second is
+ * reported on stderr at the end.
+ */
+
+#include <gst/gst.h>
+#include <string.h>
+#include <stdio.h>
+
+/* Extensions picked up when scanning directories */
+static const gchar *audio_extensions[] = {
+  ".wav", ".flac", ".ogg", ".oga", ".opus", ".mp3", ".au", ".aif", ".aiff",
+};
+
+/* Files waiting for one worker. The owner takes from the head, other
+ * workers steal from the tail. */
+typedef struct {
+  GMutex lock;
+  GQueue files;
+} ScanQueue;
+
+typedef struct {
+  ScanQueue *queues;
+  guint n_queues;
+  const gchar *config_file;
+
+  /* Output and totals, under lock */
+  GMutex lock;
+  FILE *output;
+  GstClockTime audio_time;
+  guint n_files;
+  guint n_failed;
+} Scan;
+
+typedef struct {
+  Scan *scan;
+  guint index;
+} ScanWorker;
+
+/* Append @str as a JSON string */
+static void
+json_append_string (GString * out, const gchar * str)
+{
+  g_string_append_c (out, '"');
+  for (; *str; str++) {
+    guchar c = *str;
+
+    if (c == '"' || c == '\\')
+      g_string_append_printf (out, "\\%c", c);
+    else if (c < 0x20)
+      g_string_append_printf (out, "\\u%04x", c);
+    else
+      g_string_append_c (out, c);
+  }
+  g_string_append_c (out, '"');
+}
+
+static gboolean
+is_audio_file (const gchar * name)
+{
+  gchar *lower = g_ascii_strdown (name, -1);
+  gboolean found = FALSE;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (audio_extensions) && !found; i++)
+    found = g_str_has_suffix (lower, audio_extensions[i]);
+
+  g_free (lower);
+  return found;
+}
+
+/* Add @path to @files, walking into directories */
+static void
+collect_files (const gchar * path, GPtrArray * files)
+{
+  GDir *dir;
+  const gchar *name;
+
+  if (!g_file_test (path, G_FILE_TEST_IS_DIR)) {
+    g_ptr_array_add (files, g_strdup (path));
+    return;
+  }
+
+  dir = g_dir_open (path, 0, NULL);
+  if (!dir) {
+    g_printerr ("Could not open directory %s\n", path);
+    return;
+  }
+
+  while ((name = g_dir_read_name (dir))) {
+    gchar *child = g_build_filename (path, name, NULL);
+
+    if (g_file_test (child, G_FILE_TEST_IS_DIR))
+      collect_files (child, files);
+    else if (is_audio_file (name))
+      g_ptr_array_add (files, g_strdup (child));
+    g_free (child);
+  }
+
+  g_dir_close (dir);
+}
+
+/* Add the paths listed in @list, one per line, - for stdin */
+static gboolean
+read_file_list (const gchar * list, GPtrArray * files)
+{
+  FILE *in = strcmp (list, "-") ? fopen (list, "r") : stdin;
+  gchar line[4096];
+
+  if (!in) {
+    g_printerr ("Could not open %s\n", list);
+    return FALSE;
+  }
+
+  while (fgets (line, sizeof (line), in)) {
+    g_strchomp (line);
+    if (line[0])
+      collect_files (line, files);
+  }
+
+  if (in != stdin)
+    fclose (in);
+  return TRUE;
+}
+
+/* Next file for worker @index: its own queue first, then the others */
+static gchar *
+next_file (Scan * scan, guint index)
+{
+  gchar *file;
+  guint i;
+
+  for (i = 0; i < scan->n_queues; i++) {
+    ScanQueue *queue = &scan->queues[(index + i) % scan->n_queues];
+
+    g_mutex_lock (&queue->lock);
+    file = i == 0 ? g_queue_pop_head (&queue->files) :
+        g_queue_pop_tail (&queue->files);
+    g_mutex_unlock (&queue->lock);
+
+    if (file)
+      return file;
+  }
+
+  return NULL;
+}
+
+/* Add the record of a digit-detected or pin-detected message */
+static void
+append_record (GString * out, const gchar * file, const GstStructure * s)
+{
+  guint64 timestamp = 0;
+  gint channel = 0;
+
+  gst_structure_get_int (s, "channel", &channel);
+  gst_structure_get_uint64 (s, "timestamp", &timestamp);
+
+  g_string_append (out, "{\"file\":");
+  json_append_string (out, file);
+  g_string_append_printf (out, ",\"channel\":%d,\"offset\":%.3f", channel,
+      (gdouble) timestamp / GST_SECOND);
+
+  if (gst_structure_has_name (s, "digit-detected")) {
+    g_string_append (out, ",\"digit\":");
+    json_append_string (out, gst_structure_get_string (s, "digit"));
+  } else {
+    gboolean valid = FALSE;
+
+    gst_structure_get_boolean (s, "valid", &valid);
+    g_string_append (out, ",\"pin\":");
+    json_append_string (out, gst_structure_get_string (s, "pin"));
+    g_string_append_printf (out, ",\"valid\":%s,\"function\":",
+        valid ? "true" : "false");
+    json_append_string (out, gst_structure_get_string (s, "function"));
+  }
+
+  g_string_append (out, "}\n");
+}
+
+/* Run one file through a detection pipeline */
+static void
+scan_file (Scan * scan, const gchar * file)
+{
+  GstElement *pipeline, *src, *pin;
+  GString *out = g_string_new (NULL);
+  GstClockTime audio_time = 0;
+  gchar *error = NULL;
+  GstMessage *msg;
+  GstBus *bus;
+  gint64 position;
+
+  pipeline = gst_parse_launch ("filesrc name=src ! decodebin ! "
+      "audioconvert ! audioresample ! dtmfpinsrc name=pin post-digits=true ! "
+      "fakesink sync=false", NULL);
+  if (!pipeline) {
+    g_printerr ("Could not create pipeline, is dtmfpinsrc installed?\n");
+    g_string_free (out, TRUE);
+    return;
+  }
+
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  pin = gst_bin_get_by_name (GST_BIN (pipeline), "pin");
+  g_object_set (src, "location", file, NULL);
+  g_object_set (pin, "config-file", scan->config_file, NULL);
+
+  bus = gst_element_get_bus (pipeline);
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  for (;;) {
+    msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+        GST_MESSAGE_ELEMENT | GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+
+    if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ELEMENT) {
+      const GstStructure *s = gst_message_get_structure (msg);
+
+      if (GST_MESSAGE_SRC (msg) == GST_OBJECT (pin)
+          && (gst_structure_has_name (s, "digit-detected")
+              || gst_structure_has_name (s, "pin-detected")))
+        append_record (out, file, s);
+      gst_message_unref (msg);
+      continue;
+    }
+
+    if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+      GError *err;
+
+      gst_message_parse_error (msg, &err, NULL);
+      error = g_strdup (err->message);
+      g_error_free (err);
+    } else if (gst_element_query_position (pipeline, GST_FORMAT_TIME,
+            &position) && position > 0) {
+      audio_time = position;
+    }
+    gst_message_unref (msg);
+    break;
+  }
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pin);
+  gst_object_unref (src);
+  gst_object_unref (pipeline);
+
+  g_mutex_lock (&scan->lock);
+  if (error) {
+    g_printerr ("%s: %s\n", file, error);
+    scan->n_failed++;
+  } else {
+    fwrite (out->str, 1, out->len, scan->output);
+    scan->audio_time += audio_time;
+    scan->n_files++;
+  }
+  g_mutex_unlock (&scan->lock);
+
+  g_free (error);
+  g_string_free (out, TRUE);
+}
+
+static gpointer
+scan_worker (gpointer data)
+{
+  ScanWorker *worker = data;
+  gchar *file;
+
+  while ((file = next_file (worker->scan, worker->index))) {
+    scan_file (worker->scan, file);
+    g_free (file);
+  }
+
+  return NULL;
+}
+
+int
+main (int argc, char *argv[])
+{
+  gchar *config_file = NULL, *file_list = NULL, *output = NULL;
+  gint jobs = 0;
+  GOptionEntry entries[] = {
+    {"config", 'c', 0, G_OPTION_ARG_FILENAME, &config_file,
+        "PIN configuration (.pin or .pinx), default codes.pin", "FILE"},
+    {"jobs", 'j', 0, G_OPTION_ARG_INT, &jobs,
+        "Files scanned in parallel, default one per core", "N"},
+    {"file-list", 'l', 0, G_OPTION_ARG_FILENAME, &file_list,
+        "Read paths from FILE, one per line, - for stdin", "FILE"},
+    {"output", 'o', 0, G_OPTION_ARG_FILENAME, &output,
+        "Write records to FILE instead of stdout", "FILE"},
+    {NULL}
+  };
+  GOptionContext *context;
+  GError *error = NULL;
+  GPtrArray *files;
+  GThread **threads;
+  ScanWorker *workers;
+  GTimer *timer;
+  gdouble elapsed, hours;
+  Scan scan;
+  gint i;
+
+  context = g_option_context_new ("[FILE|DIRECTORY...]");
+  g_option_context_set_summary (context,
+      "Scan recordings for DTMF digits and PINs, writing JSON lines");
+  g_option_context_add_main_entries (context, entries, NULL);
+  g_option_context_add_group (context, gst_init_get_option_group ());
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    g_error_free (error);
+    g_option_context_free (context);
+    return 1;
+  }
+  g_option_context_free (context);
+
+  files = g_ptr_array_new_with_free_func (g_free);
+  for (i = 1; i < argc; i++)
+    collect_files (argv[i], files);
+  if (file_list && !read_file_list (file_list, files))
+    return 1;
+
+  if (files->len == 0) {
+    g_printerr ("No files to scan\n");
+    return 1;
+  }
+
+  if (jobs <= 0)
+    jobs = g_get_num_processors ();
+  jobs = MIN ((guint) jobs, files->len);
+
+  memset (&scan, 0, sizeof (scan));
+  scan.config_file = config_file ? config_file : "codes.pin";
+  scan.output = output ? fopen (output, "w") : stdout;
+  if (!scan.output) {
+    g_printerr ("Could not open %s\n", output);
+    return 1;
+  }
+  g_mutex_init (&scan.lock);
+
+  /* Deal the files out round-robin, in the order given */
+  scan.n_queues = jobs;
+  scan.queues = g_new0 (ScanQueue, jobs);
+  for (i = 0; i < jobs; i++)
+    g_mutex_init (&scan.queues[i].lock);
+  for (i = 0; i < (gint) files->len; i++)
+    g_queue_push_tail (&scan.queues[i % jobs].files,
+        g_strdup (g_ptr_array_index (files, i)));
+
+  timer = g_timer_new ();
+  threads = g_new (GThread *, jobs);
+  workers = g_new (ScanWorker, jobs);
+  for (i = 0; i < jobs; i++) {
+    workers[i].scan = &scan;
+    workers[i].index = i;
+    threads[i] = g_thread_new ("dtmfpin-scan", scan_worker, &workers[i]);
+  }
+  for (i = 0; i < jobs; i++)
+    g_thread_join (threads[i]);
+  elapsed = g_timer_elapsed (timer, NULL);
+
+  if (scan.output != stdout)
+    fclose (scan.output);
+
+  hours = (gdouble) scan.audio_time / GST_SECOND / 3600.0;
+  g_printerr ("Scanned %u files (%u failed) with %d jobs: %.2f audio hours "
+      "in %.1fs, %.4f audio hours per second (%.0fx realtime)\n",
+      scan.n_files, scan.n_failed, jobs, hours, elapsed,
+      hours / elapsed, hours * 3600.0 / elapsed);
+
+  for (i = 0; i < jobs; i++)
+    g_mutex_clear (&scan.queues[i].lock);
+  g_mutex_clear (&scan.lock);
+  g_free (scan.queues);
+  g_free (workers);
+  g_free (threads);
+  g_timer_destroy (timer);
+  g_ptr_array_unref (files);
+  g_free (config_file);
+  g_free (file_list);
+  g_free (output);
+
+  return scan.n_failed ? 2 : 0;
+}